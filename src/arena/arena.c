@@ -0,0 +1,142 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * A region allocator. Memory is handed out by bumping an offset into a
+ * large block, and is only ever released all at once, which makes
+ * allocation cheap and keeps related data close together.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../catalyst.h"
+
+#define ARENA_HEADER_SIZE \
+    ARENA_ALIGN((unsigned long) sizeof(struct ArenaBlock))
+
+/*
+ * Allocate a new block with room for size bytes.
+*/
+static struct ArenaBlock *arena_block(unsigned long size) {
+    struct ArenaBlock *block = malloc(ARENA_HEADER_SIZE + size);
+
+    if(block == NULL)
+        liberror_failure(arena_block, malloc);
+
+    block->next = NULL;
+    block->length = ARENA_HEADER_SIZE + size;
+    block->used = ARENA_HEADER_SIZE;
+
+    return block;
+}
+
+void *arena_alloc(struct Arena *arena, unsigned long size) {
+    char *memory = NULL;
+    struct ArenaBlock *block = NULL;
+
+    liberror_is_null(arena_alloc, arena);
+
+    size = ARENA_ALIGN(size);
+    block = arena->blocks;
+
+    /* Large allocations get a block of their own, which goes behind the
+     * current block so that the space left in it is not wasted. */
+    if(size > ARENA_BLOCK_SIZE / 4) {
+        struct ArenaBlock *large = arena_block(size);
+
+        if(block == NULL) {
+            arena->blocks = large;
+        } else {
+            large->next = block->next;
+            block->next = large;
+        }
+
+        block = large;
+    } else if(block == NULL || block->length - block->used < size) {
+        block = arena_block(ARENA_BLOCK_SIZE - ARENA_HEADER_SIZE);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    memory = ((char *) block) + block->used;
+    block->used += size;
+    memset(memory, 0, size);
+
+    return memory;
+}
+
+void arena_adopt(struct Arena *arena, struct Arena *source) {
+    struct ArenaBlock *last = NULL;
+
+    liberror_is_null(arena_adopt, arena);
+    liberror_is_null(arena_adopt, source);
+
+    if(source->blocks == NULL)
+        return;
+
+    /* The blocks go behind the current block of the arena, so that it
+     * keeps allocating from the same place. */
+    for(last = source->blocks; last->next != NULL; last = last->next)
+        continue;
+
+    if(arena->blocks == NULL) {
+        arena->blocks = source->blocks;
+    } else {
+        last->next = arena->blocks->next;
+        arena->blocks->next = source->blocks;
+    }
+
+    source->blocks = NULL;
+}
+
+void arena_free(struct Arena *arena) {
+    struct ArenaBlock *block = NULL;
+
+    liberror_is_null(arena_free, arena);
+
+    block = arena->blocks;
+
+    while(block != NULL) {
+        struct ArenaBlock *next = block->next;
+
+        free(block);
+        block = next;
+    }
+
+    arena->blocks = NULL;
+}
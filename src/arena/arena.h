@@ -0,0 +1,150 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CWARE_CATALYST_ARENA_H
+#define CWARE_CATALYST_ARENA_H
+
+#define ARENA_BLOCK_SIZE    (64 * 1024)
+#define ARENA_ALIGNMENT     16
+
+#define ARENA_ALIGN(size) \
+    (((size) + (ARENA_ALIGNMENT - 1)) & ~((unsigned long) ARENA_ALIGNMENT - 1))
+
+/*
+ * @docgen: structure
+ * @brief: a block of memory that an arena allocates from
+ * @name: ArenaBlock
+ *
+ * @field next: the block that was filled before this one
+ * @type: struct ArenaBlock *
+ *
+ * @field length: the number of bytes in the block
+ * @type: unsigned long
+ *
+ * @field used: the number of bytes allocated from the block
+ * @type: unsigned long
+*/
+struct ArenaBlock {
+    struct ArenaBlock *next;
+    unsigned long length;
+    unsigned long used;
+};
+
+/*
+ * @docgen: structure
+ * @brief: a region that memory is allocated from and released all at once
+ * @name: Arena
+ *
+ * @field blocks: the block being allocated from, or NULL
+ * @type: struct ArenaBlock *
+*/
+struct Arena {
+    struct ArenaBlock *blocks;
+};
+
+/*
+ * @docgen: function
+ * @brief: allocate memory from an arena
+ * @name: arena_alloc
+ *
+ * @include: arena.h
+ *
+ * @description
+ * @This function will allocate size bytes of zeroed memory from the
+ * @arena, aligned to ARENA_ALIGNMENT. The memory is valid until the
+ * @arena is released with arena_free. Allocations that do not fit in
+ * @the current block get a new block, which is at least ARENA_BLOCK_SIZE
+ * @bytes long.
+ * @description
+ *
+ * @error: arena is NULL
+ *
+ * @param arena: the arena to allocate from
+ * @type: struct Arena *
+ *
+ * @param size: the number of bytes to allocate
+ * @type: unsigned long
+ *
+ * @return: the allocated memory
+ * @type: void *
+*/
+void *arena_alloc(struct Arena *arena, unsigned long size);
+
+/*
+ * @docgen: function
+ * @brief: move the memory of one arena into another
+ * @name: arena_adopt
+ *
+ * @include: arena.h
+ *
+ * @description
+ * @This function will give every block of source to arena, so that the
+ * @allocations made from source are released along with arena. The
+ * @source arena is empty after.
+ * @description
+ *
+ * @error: arena is NULL
+ * @error: source is NULL
+ *
+ * @param arena: the arena to move the memory into
+ * @type: struct Arena *
+ *
+ * @param source: the arena to move the memory out of
+ * @type: struct Arena *
+*/
+void arena_adopt(struct Arena *arena, struct Arena *source);
+
+/*
+ * @docgen: function
+ * @brief: release an arena from memory
+ * @name: arena_free
+ *
+ * @include: arena.h
+ *
+ * @description
+ * @This function will release every block of the arena, and so every
+ * @allocation that was made from it. The arena can be reused after.
+ * @description
+ *
+ * @error: arena is NULL
+ *
+ * @param arena: the arena to release
+ * @type: struct Arena *
+*/
+void arena_free(struct Arena *arena);
+
+#endif
@@ -3,16 +3,19 @@
 
 #include "libc99/libc99.h"
 #include "carray/carray.h"
+#include "chashmap/chashmap.h"
 #include "libproc/libproc.h"
 #include "cstring/cstring.h"
 #include "libpath/libpath.h"
 #include "libproc/libproc.h"
 #include "libmatch/libmatch.h"
+#include "arena/arena.h"
 
 struct Configuration;
 
 /* Configuration */
 #define CONFIGURATION_FILE  ".catalyst"
+#define CONFIGURATION_CACHE_SUFFIX  ".cache"
 #define TESTS_DIRECTORY     "tests"
 
 /* Useful macros */
@@ -36,8 +39,17 @@ struct Configuration;
  * @or not a job failed to compile the program, or if it succeeded. This
  * @way the user does not have to read through multiple (potentially large)
  * @log files just to see if a test failed to compile.
+ * @
+ * @At most limit test runners are kept running at once, or one for
+ * @every testcase if the limit is zero.
  * @description
+ *
+ * @param configuration: the configuration to run
+ * @type: struct Configuration
+ *
+ * @param limit: the most test runners to run at once
+ * @type: int
 */
-void handle_jobs(struct Configuration configuration);
+void handle_jobs(struct Configuration configuration, int limit);
 
 #endif
@@ -0,0 +1,277 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * An implementation of a hash table with open addressing.
+ *
+ * Like carray, the table is a structure declared by the user, and every
+ * operation takes a namespace whose macros describe the values in it:
+ *
+ *     NAMESPACE_TYPE              the type of the values
+ *     NAMESPACE_HASH(value)       an unsigned long hash of a value
+ *     NAMESPACE_COMPARE(a, b)     1 if two values are equal, 0 if not
+ *     NAMESPACE_FREE(value)       release a value
+ *     NAMESPACE_HEAP              1 if the table is on the heap
+ *
+ * The structure must have the fields
+ *
+ *     int length;
+ *     int used;
+ *     int capacity;
+ *     unsigned char *states;
+ *     NAMESPACE_TYPE *contents;
+ *
+ * Values live directly in one array, and a parallel array holds one
+ * state byte per slot, so probing touches as little memory as possible.
+ * Collisions are resolved with linear probing, and the capacity is a
+ * power of two that doubles once the table is three quarters full. The
+ * used field counts both values and the slots of removed values, which
+ * are reclaimed the next time the table is rebuilt.
+ * Lookups take a value rather than a key, so to look up by a key, fill
+ * in only the fields of a value that HASH and COMPARE look at.
+*/
+
+#ifndef CWARE_LIBCHASHMAP_H
+#define CWARE_LIBCHASHMAP_H
+
+#define CHASHMAP_VERSION "1.0.0"
+
+#ifndef CHASHMAP_INITIAL_SIZE
+#define CHASHMAP_INITIAL_SIZE 16
+#endif
+
+/* Slot states */
+#define CHASHMAP_EMPTY      0
+#define CHASHMAP_FULL       1
+#define CHASHMAP_DELETED    2
+
+#define CHASHMAP_NOT_FOUND  -1
+
+/* Whether or not a table with this many used slots must grow */
+#define __chashmap_overloaded(used, capacity) \
+    ((used) * 4 >= (capacity) * 3)
+
+#define __chashmap_assert_nonnull(macro_name, argument, value)                \
+do {                                                                          \
+    if((value) == NULL) {                                                     \
+        fprintf(stderr, "%s: %s cannot be NULL (%s:%i)\n", macro_name,        \
+                        argument, __FILE__, __LINE__);                        \
+        abort();                                                              \
+    }                                                                         \
+} while(0)
+
+/* Operations */
+
+#define chashmap_init(map, namespace)                                         \
+    (map);                                                                    \
+                                                                              \
+    (map) = malloc(sizeof(*(map)));                                           \
+    (map)->length = 0;                                                        \
+    (map)->used = 0;                                                          \
+    (map)->capacity = CHASHMAP_INITIAL_SIZE;                                  \
+    (map)->states = calloc(CHASHMAP_INITIAL_SIZE, 1);                         \
+    (map)->contents = calloc(CHASHMAP_INITIAL_SIZE,                           \
+                             sizeof(namespace ## _TYPE))
+
+/*
+ * Stores the slot of the value equal to value in location, or
+ * CHASHMAP_NOT_FOUND.
+*/
+#define chashmap_find(map, value, location, namespace)                        \
+do {                                                                          \
+    unsigned long __CHASHMAP_SLOT = 0;                                        \
+                                                                              \
+    __chashmap_assert_nonnull("chashmap_find", "map", map);                   \
+                                                                              \
+    (location) = CHASHMAP_NOT_FOUND;                                          \
+    __CHASHMAP_SLOT = (namespace ## _HASH(value)) &                           \
+                      (unsigned long) ((map)->capacity - 1);                  \
+                                                                              \
+    while((map)->states[__CHASHMAP_SLOT] != CHASHMAP_EMPTY) {                 \
+        if((map)->states[__CHASHMAP_SLOT] == CHASHMAP_FULL &&                 \
+           namespace ## _COMPARE((map)->contents[__CHASHMAP_SLOT],            \
+                                 value) == 1) {                               \
+            (location) = (int) __CHASHMAP_SLOT;                               \
+            break;                                                            \
+        }                                                                     \
+                                                                              \
+        __CHASHMAP_SLOT = (__CHASHMAP_SLOT + 1) &                             \
+                          (unsigned long) ((map)->capacity - 1);              \
+    }                                                                         \
+} while(0)
+
+/*
+ * Rebuild the table with a new capacity, which drops the slots of
+ * removed values.
+*/
+#define chashmap_resize(map, _capacity, namespace)                            \
+do {                                                                          \
+    int __CHASHMAP_INDEX = 0;                                                 \
+    int __CHASHMAP_OLD_CAPACITY = (map)->capacity;                            \
+    unsigned char *__CHASHMAP_OLD_STATES = (map)->states;                     \
+    namespace ## _TYPE *__CHASHMAP_OLD_CONTENTS = (map)->contents;            \
+                                                                              \
+    (map)->used = (map)->length;                                              \
+    (map)->capacity = (_capacity);                                            \
+    (map)->states = calloc((size_t) (map)->capacity, 1);                      \
+    (map)->contents = calloc((size_t) (map)->capacity,                        \
+                             sizeof(namespace ## _TYPE));                     \
+                                                                              \
+    for(__CHASHMAP_INDEX = 0; __CHASHMAP_INDEX < __CHASHMAP_OLD_CAPACITY;     \
+                                                     __CHASHMAP_INDEX++) {    \
+        unsigned long __CHASHMAP_RESLOT = 0;                                  \
+                                                                              \
+        if(__CHASHMAP_OLD_STATES[__CHASHMAP_INDEX] != CHASHMAP_FULL)          \
+            continue;                                                         \
+                                                                              \
+        __CHASHMAP_RESLOT = (namespace ## _HASH(                              \
+                             __CHASHMAP_OLD_CONTENTS[__CHASHMAP_INDEX])) &    \
+                          (unsigned long) ((map)->capacity - 1);              \
+                                                                              \
+        while((map)->states[__CHASHMAP_RESLOT] != CHASHMAP_EMPTY)             \
+            __CHASHMAP_RESLOT = (__CHASHMAP_RESLOT + 1) &                     \
+                              (unsigned long) ((map)->capacity - 1);          \
+                                                                              \
+        (map)->states[__CHASHMAP_RESLOT] = CHASHMAP_FULL;                     \
+        (map)->contents[__CHASHMAP_RESLOT] =                                  \
+                                __CHASHMAP_OLD_CONTENTS[__CHASHMAP_INDEX];    \
+    }                                                                         \
+                                                                              \
+    free(__CHASHMAP_OLD_STATES);                                              \
+    free(__CHASHMAP_OLD_CONTENTS);                                            \
+} while(0)
+
+/*
+ * Inserts value into the table. If an equal value is already in the
+ * table, it is replaced (but not released).
+*/
+#define chashmap_insert(map, value, namespace)                                \
+do {                                                                          \
+    int __CHASHMAP_TARGET = CHASHMAP_NOT_FOUND;                               \
+    unsigned long __CHASHMAP_SLOT = 0;                                        \
+                                                                              \
+    __chashmap_assert_nonnull("chashmap_insert", "map", map);                 \
+                                                                              \
+    /* Only grow if the values themselves fill the table-- otherwise,         \
+     * rebuilding at the same size is enough to drop removed slots. */        \
+    if(__chashmap_overloaded((map)->used + 1, (map)->capacity) == 1) {        \
+        chashmap_resize(map, __chashmap_overloaded((map)->length * 2 + 1,     \
+                                                   (map)->capacity) == 1 ?    \
+                             (map)->capacity * 2 : (map)->capacity,           \
+                        namespace);                                           \
+    }                                                                         \
+                                                                              \
+    __CHASHMAP_SLOT = (namespace ## _HASH(value)) &                           \
+                      (unsigned long) ((map)->capacity - 1);                  \
+                                                                              \
+    /* Replace an equal value, or take the first free slot on the way */      \
+    while((map)->states[__CHASHMAP_SLOT] != CHASHMAP_EMPTY) {                 \
+        if((map)->states[__CHASHMAP_SLOT] == CHASHMAP_FULL &&                 \
+           namespace ## _COMPARE((map)->contents[__CHASHMAP_SLOT],            \
+                                 value) == 1) {                               \
+            __CHASHMAP_TARGET = (int) __CHASHMAP_SLOT;                        \
+            (map)->length--;                                                  \
+            break;                                                            \
+        }                                                                     \
+                                                                              \
+        if((map)->states[__CHASHMAP_SLOT] == CHASHMAP_DELETED &&              \
+           __CHASHMAP_TARGET == CHASHMAP_NOT_FOUND)                           \
+            __CHASHMAP_TARGET = (int) __CHASHMAP_SLOT;                        \
+                                                                              \
+        __CHASHMAP_SLOT = (__CHASHMAP_SLOT + 1) &                             \
+                          (unsigned long) ((map)->capacity - 1);              \
+    }                                                                         \
+                                                                              \
+    if(__CHASHMAP_TARGET == CHASHMAP_NOT_FOUND) {                             \
+        __CHASHMAP_TARGET = (int) __CHASHMAP_SLOT;                            \
+        (map)->used++;                                                        \
+    }                                                                         \
+                                                                              \
+    (map)->states[__CHASHMAP_TARGET] = CHASHMAP_FULL;                         \
+    (map)->contents[__CHASHMAP_TARGET] = value;                               \
+    (map)->length++;                                                          \
+} while(0)
+
+/*
+ * Removes the value equal to value from the table, and releases it.
+*/
+#define chashmap_remove(map, value, namespace)                                \
+do {                                                                          \
+    int __CHASHMAP_LOCATION = CHASHMAP_NOT_FOUND;                             \
+                                                                              \
+    chashmap_find(map, value, __CHASHMAP_LOCATION, namespace);                \
+                                                                              \
+    if(__CHASHMAP_LOCATION == CHASHMAP_NOT_FOUND) {                           \
+        fprintf(stderr, "chashmap_remove: attempt to remove value '%s' that " \
+                        "is not in table. (%s:%i)\n", #value, __FILE__,       \
+                        __LINE__);                                            \
+        abort();                                                              \
+    }                                                                         \
+                                                                              \
+    namespace ## _FREE((map)->contents[__CHASHMAP_LOCATION]);                 \
+    (map)->states[__CHASHMAP_LOCATION] = CHASHMAP_DELETED;                    \
+    (map)->length--;                                                          \
+} while(0)
+
+#define chashmap_free(map, namespace)                                         \
+do {                                                                          \
+    int __CHASHMAP_INDEX = 0;                                                 \
+                                                                              \
+    __chashmap_assert_nonnull("chashmap_free", "map", map);                   \
+                                                                              \
+    for(__CHASHMAP_INDEX = 0; __CHASHMAP_INDEX < (map)->capacity;             \
+                                                     __CHASHMAP_INDEX++) {    \
+        if((map)->states[__CHASHMAP_INDEX] != CHASHMAP_FULL)                  \
+            continue;                                                         \
+                                                                              \
+        namespace ## _FREE((map)->contents[__CHASHMAP_INDEX]);                \
+    }                                                                         \
+                                                                              \
+    free((map)->states);                                                      \
+    free((map)->contents);                                                    \
+                                                                              \
+    if(namespace ## _HEAP == 1)                                               \
+        free((map));                                                          \
+} while(0)
+
+#define chashmap_length(map) \
+    ((map)->length)
+
+#define chashmap_is_full(map, slot) \
+    ((map)->states[(slot)] == CHASHMAP_FULL)
+
+#endif
@@ -40,51 +40,32 @@
  * files might find handy.
 */
 
+/* pipe2 and memfd_create are only declared for GNU code */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sys/mman.h>
+#else
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "common.h"
 #include "../catalyst.h"
 #include "../parsers/parsers.h"
 
 void free_configuration(struct Configuration configuration) {
-    int index = 0;
-
-    /* Release the jobs */
-    for(index = 0; index < carray_length(configuration.jobs); index++) {
-        int array_index = 0;
-        struct Job job = configuration.jobs->contents[index];
-
-        cstring_free(job.name);
-        cstring_free(job.make_path);
-
-        for(array_index = 0; array_index < carray_length(job.make_arguments); array_index++) {
-            cstring_free(job.make_arguments->contents[array_index]);
-        }
+    /* Everything in a cached configuration lives in one mapping */
+    if(configuration.image != NULL) {
+        free_configuration_cache(configuration);
 
-        free(job.make_arguments->contents);
-        free(job.make_arguments);
+        return;
     }
 
-    free(configuration.jobs->contents);
-    free(configuration.jobs);
-
-    /* Release the test cases */
-    for(index = 0; index < carray_length(configuration.testcases); index++) {
-        int array_index = 0;
-        struct Testcase testcase = configuration.testcases->contents[index];
-
-        cstring_free(testcase.path);
-        cstring_free(testcase.input);
-        cstring_free(testcase.output);
-
-        for(array_index = 0; array_index < carray_length(testcase.argv); array_index++) {
-            cstring_free(testcase.argv->contents[array_index]);
-        }
-
-        free(testcase.argv->contents);
-        free(testcase.argv);
-    }
-
-    free(configuration.testcases->contents);
-    free(configuration.testcases);
+    /* Everything in a parsed configuration lives in its arena */
+    arena_free(&configuration.arena);
 }
 
 void verify_testcase_validity(struct Configuration configuration) {
@@ -110,3 +91,74 @@ void verify_testcase_validity(struct Configuration configuration) {
 
     cstring_free(path_string);
 }
+
+int cloexec_pipe(int descriptors[2]) {
+    /* Where the pipe can be made close-on-exec from the start, no other
+     * thread can fork and exec in between and leak it. */
+#if defined(__linux__)
+    return pipe2(descriptors, O_CLOEXEC);
+#else
+    if(pipe(descriptors) == -1)
+        return -1;
+
+    fcntl(descriptors[0], F_SETFD, FD_CLOEXEC);
+    fcntl(descriptors[1], F_SETFD, FD_CLOEXEC);
+
+    return 0;
+#endif
+}
+
+int sealed_file(const char *contents, int length) {
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+    int written = 0;
+    int descriptor = memfd_create("catalyst", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if(descriptor == -1)
+        return -1;
+
+    while(written < length) {
+        int bytes = (int) write(descriptor, contents + written, length - written);
+
+        if(bytes == -1 && errno == EINTR)
+            continue;
+
+        if(bytes == -1) {
+            close(descriptor);
+
+            return -1;
+        }
+
+        written += bytes;
+    }
+
+    /* Nothing can change the contents from here on, so every process
+     * that has the file can trust them. */
+    if(fcntl(descriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        close(descriptor);
+
+        return -1;
+    }
+
+    return descriptor;
+#else
+    return -1;
+#endif
+}
+
+/* FNV-1a, truncated to 32 bits so that it is the same everywhere, which
+ * the configuration cache relies on for its key */
+#define HASH_BASIS  2166136261UL
+#define HASH_PRIME  16777619UL
+#define HASH_MASK   0xFFFFFFFFUL
+
+unsigned long hash_bytes(const char *bytes, int length) {
+    int index = 0;
+    unsigned long hash = HASH_BASIS;
+
+    for(index = 0; index < length; index++) {
+        hash ^= (unsigned char) bytes[index];
+        hash = (hash * HASH_PRIME) & HASH_MASK;
+    }
+
+    return hash;
+}
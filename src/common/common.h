@@ -74,4 +74,74 @@ void free_configuration(struct Configuration configuration);
 */
 void verify_testcase_validity(struct Configuration configuration);
 
+/*
+ * @docgen: function
+ * @brief: make a pipe that is closed on exec
+ * @name: cloexec_pipe
+ *
+ * @include: catalyst.h
+ *
+ * @description
+ * @Makes a pipe like pipe(2), but with both ends closed when the
+ * @process execs, so that they are not inherited by tests. An end
+ * @that a test should have must be duplicated onto it with dup(2),
+ * @which does not carry the flag over.
+ * @description
+ *
+ * @param descriptors: where to put the read and write ends
+ * @type: int [2]
+ *
+ * @return: 0 on success, -1 with errno set on failure
+ * @type: int
+*/
+int cloexec_pipe(int descriptors[2]);
+
+/*
+ * @docgen: function
+ * @brief: make a sealed file in memory
+ * @name: sealed_file
+ *
+ * @include: catalyst.h
+ *
+ * @description
+ * @Makes an anonymous file in memory that holds the given bytes, and
+ * @seals it so that it can no longer be written to, grown or shrunk.
+ * @The file is closed on exec. Sealed files are only made on Linux, with
+ * @memfd_create.
+ * @description
+ *
+ * @param contents: the bytes to put in the file
+ * @type: const char *
+ *
+ * @param length: the number of bytes to put in the file
+ * @type: int
+ *
+ * @return: the descriptor of the file, or -1 if it could not be made
+ * @type: int
+*/
+int sealed_file(const char *contents, int length);
+
+/*
+ * @docgen: function
+ * @brief: hash an array of bytes
+ * @name: hash_bytes
+ *
+ * @include: catalyst.h
+ *
+ * @description
+ * @Computes the FNV-1a hash of an array of bytes, for use as the
+ * @hash function of a chashmap.
+ * @description
+ *
+ * @param bytes: the bytes to hash
+ * @type: const char *
+ *
+ * @param length: the number of bytes to hash
+ * @type: int
+ *
+ * @return: the hash of the bytes
+ * @type: unsigned long
+*/
+unsigned long hash_bytes(const char *bytes, int length);
+
 #endif
@@ -55,10 +55,12 @@ struct CString cstring_init(const char *body) {
     body_length = strlen(body);
     cstring.length = body_length;
     cstring.capacity = body_length + 1;
-    cstring.contents = malloc(body_length + 1);
 
-    cstring.contents[0] = '\0';
-    strncat(cstring.contents, body, body_length);
+    if(cstring.capacity < CSTRING_MINIMUM_CAPACITY)
+        cstring.capacity = CSTRING_MINIMUM_CAPACITY;
+
+    cstring.contents = malloc(cstring.capacity);
+    memcpy(cstring.contents, body, body_length);
     cstring.contents[body_length] = '\0';
 
     return cstring;
@@ -70,10 +72,32 @@ void cstring_free(struct CString cstring) {
     free(cstring.contents);
 }
 
+void cstring_reserve(struct CString *cstring, int length) {
+    int capacity = 0;
+
+    liberror_is_null(cstring_reserve, cstring);
+    liberror_is_null(cstring_reserve, cstring->contents);
+    liberror_is_negative(cstring_reserve, length);
+
+    if(length + 1 <= cstring->capacity)
+        return;
+
+    capacity = CSTRING_RESIZE(cstring->capacity);
+
+    if(capacity < length + 1)
+        capacity = length + 1;
+
+    if(capacity < CSTRING_MINIMUM_CAPACITY)
+        capacity = CSTRING_MINIMUM_CAPACITY;
+
+    cstring->contents = realloc(cstring->contents, capacity);
+    cstring->capacity = capacity;
+}
+
 /* Addition based operations */
 void cstring_concat(struct CString *cstring_a, struct CString cstring_b) {
-    int index = 0;
     int new_length = 0;
+    long source = -1;
 
     liberror_is_null(cstring_concat, cstring_a);
     liberror_is_null(cstring_concat, cstring_a->contents);
@@ -91,21 +115,23 @@ void cstring_concat(struct CString *cstring_a, struct CString cstring_b) {
 
     new_length = cstring_a->length + cstring_b.length;
 
-    /* Resize buffer first if the new length is above the old length.
-     * This would be a factor in a situation where the string was
-     * reset, and then we concatenate to the reset string. This is
-     * essentially so we do not shrink the string. */
-    if(new_length > cstring_a->length)
-        cstring_a->contents = realloc(cstring_a->contents, new_length + 1);
-
-    for(index = 0; index < cstring_b.length; index++) {
-        cstring_a->contents[cstring_a->length + index] = cstring_b.contents[index];
+    /* Growing cstring_a can move it, which would leave cstring_b behind
+     * if it is a part of cstring_a. */
+    if(cstring_b.contents >= cstring_a->contents &&
+       cstring_b.contents < cstring_a->contents + cstring_a->capacity) {
+        source = cstring_b.contents - cstring_a->contents;
     }
 
+    cstring_reserve(cstring_a, new_length);
+
+    if(source != -1)
+        cstring_b.contents = cstring_a->contents + source;
+
+    memmove(cstring_a->contents + cstring_a->length, cstring_b.contents, cstring_b.length);
+
     /* Finalize cstring_a */
-    cstring_a->contents[cstring_a->length + index] = '\0';
+    cstring_a->contents[new_length] = '\0';
     cstring_a->length = new_length;
-    cstring_a->capacity = new_length + 1;
 }
 
 void cstring_concats(struct CString *cstring, const char *string) {
@@ -124,7 +150,7 @@ void cstring_concats(struct CString *cstring, const char *string) {
      * it away. That being said, casting away const here is.. less than
      * optimal. It will definitely raise a few eyebrows. */
     new_string.length = strlen(string);
-    new_string.capacity = strlen(string) + 1;
+    new_string.capacity = new_string.length + 1;
     new_string.contents = (char *) string;
 
     cstring_concat(cstring, new_string);
@@ -134,8 +160,12 @@ void cstring_concats(struct CString *cstring, const char *string) {
 
 /* Removal based operations */
 int cstring_strip(struct CString *cstring, struct CString target) {
-    int index = 0;
+    int read = 0;
+    int write = 0;
+    int state = 0;
     int strips = 0;
+    int *failure = NULL;
+    int *states = NULL;
 
     liberror_is_null(cstring_strip, cstring);
     liberror_is_null(cstring_strip, cstring->contents);
@@ -145,21 +175,57 @@ int cstring_strip(struct CString *cstring, struct CString target) {
 
     /* A target string cannot be removed from a string that
      * it is larger than */
-    if(target.length > cstring->length)
+    if(target.length == 0 || target.length > cstring->length)
         return 0;
 
-    /* Keep stripping a string from the location its found.
-     * This could be a bit simpler. Maybe having a cursor
-     * and then simply shifting over everything after
-     * index + target.length */
-    while((index = cstring_find(*cstring, target)) != CSTRING_NOT_FOUND) {
-        memmove(cstring->contents + index, cstring->contents + index + target.length, sizeof(char) * (cstring->length - target.length - index));
-        cstring->contents[cstring->length - target.length] = '\0';
-        cstring->length -= target.length;
+    /* The string is copied onto itself one character at a time, while
+     * matching the target with a KMP automaton. When the target has just
+     * been copied, it is taken back off, and the automaton is put back
+     * into the state it was in before it. This removes the occurrences
+     * that a removal forms as well, without scanning the string again. */
+    failure = malloc(sizeof(int) * target.length);
+    states = malloc(sizeof(int) * (cstring->length + 1));
+    failure[0] = 0;
+
+    for(read = 1; read < target.length; read++) {
+        while(state > 0 && target.contents[read] != target.contents[state])
+            state = failure[state - 1];
 
-        strips++;
+        if(target.contents[read] == target.contents[state])
+            state++;
+
+        failure[read] = state;
     }
 
+    state = 0;
+    states[0] = 0;
+
+    for(read = 0; read < cstring->length; read++) {
+        char character = cstring->contents[read];
+
+        cstring->contents[write++] = character;
+
+        while(state > 0 && target.contents[state] != character)
+            state = failure[state - 1];
+
+        if(target.contents[state] == character)
+            state++;
+
+        if(state == target.length) {
+            write -= target.length;
+            state = states[write];
+            strips++;
+        }
+
+        states[write] = state;
+    }
+
+    cstring->contents[write] = '\0';
+    cstring->length = write;
+
+    free(failure);
+    free(states);
+
     return strips;
 }
 
@@ -178,31 +244,175 @@ int cstring_strips(struct CString *cstring, const char *target) {
 }
 
 /* Searching / condition based operations */
+
+/*
+ * Split the needle into a left and right half so that the Two-Way search
+ * can match the right half forwards, and then the left half backwards.
+ * Returns where the right half starts, and stores the period of the
+ * needle in period.
+*/
+static int critical_factorization(const unsigned char *needle, int length, int *period) {
+    int index = 0;
+    int offset = 1;
+    int suffix = -1;
+    int reverse_suffix = -1;
+    int reverse_period = 1;
+
+    /* Maximal suffix with the usual ordering */
+    *period = 1;
+
+    while(index + offset < length) {
+        int a = needle[index + offset];
+        int b = needle[suffix + offset];
+
+        if(a < b) {
+            index += offset;
+            offset = 1;
+            *period = index - suffix;
+        } else if(a == b) {
+            if(offset != *period) {
+                offset++;
+            } else {
+                index += *period;
+                offset = 1;
+            }
+        } else {
+            suffix = index++;
+            offset = *period = 1;
+        }
+    }
+
+    /* Maximal suffix with the reverse ordering */
+    index = 0;
+    offset = 1;
+
+    while(index + offset < length) {
+        int a = needle[index + offset];
+        int b = needle[reverse_suffix + offset];
+
+        if(b < a) {
+            index += offset;
+            offset = 1;
+            reverse_period = index - reverse_suffix;
+        } else if(a == b) {
+            if(offset != reverse_period) {
+                offset++;
+            } else {
+                index += reverse_period;
+                offset = 1;
+            }
+        } else {
+            reverse_suffix = index++;
+            offset = reverse_period = 1;
+        }
+    }
+
+    /* The later of the two is the critical factorization */
+    if(reverse_suffix < suffix)
+        return suffix + 1;
+
+    *period = reverse_period;
+
+    return reverse_suffix + 1;
+}
+
 int cstring_find(struct CString haystack, struct CString needle) {
     int index = 0;
+    int period = 0;
+    int suffix = 0;
+    int memory = 0;
+    int position = 0;
+    const unsigned char *text = NULL;
+    const unsigned char *pattern = NULL;
 
     liberror_is_negative(cstring_find, haystack.length);
     liberror_is_negative(cstring_find, needle.length);
     liberror_is_null(cstring_find, cstring_string(haystack));
     liberror_is_null(cstring_find, cstring_string(needle));
 
-    for(index = 0; index < haystack.length; index++) {
-        int cursor = 0;
+    if(needle.length > haystack.length || haystack.length == 0)
+        return CSTRING_NOT_FOUND;
+
+    if(needle.length == 0)
+        return 0;
+
+    text = (const unsigned char *) haystack.contents;
+    pattern = (const unsigned char *) needle.contents;
+
+    /* A single character is just a scan */
+    if(needle.length == 1) {
+        const unsigned char *found = memchr(text, pattern[0], haystack.length);
+
+        return found == NULL ? CSTRING_NOT_FOUND : (int) (found - text);
+    }
+
+    suffix = critical_factorization(pattern, needle.length, &period);
+
+    /* A periodic needle remembers how much of its left half is known to
+     * match after a shift by the period, so that it is not compared
+     * again. */
+    if(memcmp(pattern, pattern + period, suffix) == 0) {
+        while(position <= haystack.length - needle.length) {
+            index = suffix > memory ? suffix : memory;
+
+            while(index < needle.length && pattern[index] == text[index + position])
+                index++;
+
+            if(index < needle.length) {
+                position += index - suffix + 1;
+                memory = 0;
 
-        for(cursor = 0; cursor < needle.length; cursor++) {
-            if(cstring_string(haystack)[index + cursor] == cstring_string(needle)[cursor])
                 continue;
+            }
+
+            index = suffix - 1;
+
+            while(index >= memory && pattern[index] == text[index + position])
+                index--;
+
+            if(index < memory)
+                return position;
 
-            /* Premature ending-- cursor will not be equal to cstring_b.length,
-             * which will signal that this is NOT a match */
-            break;
+            position += period;
+            memory = needle.length - period;
         }
 
-        /* Signals an icorrect match */
-        if(cursor != needle.length)
+        return CSTRING_NOT_FOUND;
+    }
+
+    /* Otherwise, a mismatch can shift the needle past the longer half.
+     * The first character of the right half has to be in the haystack for
+     * there to be a match, so skip ahead to it with memchr. */
+    period = (suffix > needle.length - suffix ? suffix : needle.length - suffix) + 1;
+
+    while(position <= haystack.length - needle.length) {
+        const unsigned char *found = memchr(text + position + suffix, pattern[suffix],
+                                            haystack.length - needle.length - position + 1);
+
+        if(found == NULL)
+            return CSTRING_NOT_FOUND;
+
+        position = (int) (found - text) - suffix;
+        index = suffix + 1;
+
+        while(index < needle.length && pattern[index] == text[index + position])
+            index++;
+
+        if(index < needle.length) {
+            position += index - suffix + 1;
+
             continue;
+        }
+
+        index = suffix - 1;
+
+        while(index >= 0 && pattern[index] == text[index + position])
+            index--;
+
+        if(index < 0)
+            return position;
 
-        return index;
+        position += period;
     }
 
     return CSTRING_NOT_FOUND;
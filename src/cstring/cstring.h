@@ -56,6 +56,7 @@
  * @embed function: cstring_startswiths
  * @embed function: cstring_startswith
  * @embed function: cstring_concat
+ * @embed function: cstring_reserve
  * @embed function: cstring_slice
  *
  * @description
@@ -89,6 +90,7 @@
  * @cstring_startswiths(cware);check if a cstring starts with a c-style string
  * @cstring_startswith(cware);check if a cstring starts with a cstring
  * @cstring_concat(cware);concatenate a cstring onto another cstring
+ * @cstring_reserve(cware);make room for a cstring to grow
  * @cstring_slice(cware);slice a range of a cstring
  * @table
  * @
@@ -104,6 +106,18 @@
 
 #define CSTRING_NOT_FOUND   -1
 
+/* Every allocated cstring has room for at least this many bytes, so
+ * that short strings can be built up without reallocating. */
+#ifndef CSTRING_MINIMUM_CAPACITY
+#define CSTRING_MINIMUM_CAPACITY 16
+#endif
+
+/* Growth of a cstring that has run out of capacity */
+#ifndef CSTRING_RESIZE
+#define CSTRING_RESIZE(capacity) \
+    ((capacity) * 2)
+#endif
+
 /*
  * @docgen: macro_function
  * @brief: get the string from the cstring
@@ -122,7 +136,7 @@
  * @field length: the length of the string
  * @type: int
  *
- * @field capacity: the physical capacity of the string
+ * @field capacity: the physical capacity of the string, including the NUL byte
  * @type: int
  *
  * @field contents: the characters in the string
@@ -296,7 +310,9 @@ void cstring_reset(struct CString *cstring);
  * @include: cstring.h
  * 
  * @description
- * @Concatenates string_a into string_b, modifying string_a in-place.
+ * @Concatenates string_a into string_b, modifying string_a in-place. When
+ * @string_a runs out of capacity, its capacity grows geometrically, so
+ * @building a string up with many concatenations takes linear time.
  * @description
  *
  * @example
@@ -331,6 +347,49 @@ void cstring_reset(struct CString *cstring);
 */
 void cstring_concat(struct CString *cstring_a, struct CString cstring_b);
 
+/*
+ * @docgen: function
+ * @brief: make room for a cstring to grow
+ * @name: cstring_reserve
+ *
+ * @include: cstring.h
+ * 
+ * @description
+ * @Makes sure that the cstring has room for at least length characters
+ * @and the NUL byte, so that it can grow to that length without any
+ * @more allocations. The capacity is never shrunk.
+ * @description
+ *
+ * @example
+ * @#include "cstring.h"
+ * @
+ * @int main(void) {
+ * @    int index = 0;
+ * @    struct CString string = cstring_init("");
+ * @
+ * @    cstring_reserve(&string, 3 * 1000);
+ * @
+ * @    for(index = 0; index < 1000; index++)
+ * @        cstring_concats(&string, "foo");
+ * @
+ * @    cstring_free(string);
+ * @
+ * @    return 0;
+ * @}
+ * @example
+ *
+ * @error: cstring is NULL
+ * @error: cstring->contents is NULL
+ * @error: length is negative
+ *
+ * @param cstring: the cstring to make room in
+ * @type: struct CString *
+ *
+ * @param length: the length to make room for
+ * @type: int
+*/
+void cstring_reserve(struct CString *cstring, int length);
+
 /*
  * @docgen: function
  * @brief: concatenate a c-style string to a cstring
@@ -375,7 +434,9 @@ void cstring_concats(struct CString *cstring, const char *string);
  * @include: cstring.h
  *
  * @description
- * @Determine the location of a needle in a haystack.
+ * @Determine the location of a needle in a haystack. The search uses
+ * @the Two-Way algorithm, so it takes time linear in the length of the
+ * @haystack and needle, and never reads past the end of the haystack.
  * @description
  *
  * @example
@@ -653,7 +714,8 @@ int cstring_endswiths(struct CString cstring, const char *check);
  * @description
  * @Remove all occurrences of a cstring from another cstring.
  * @This is an in-place operation, and thus will modify the
- * @cstring.
+ * @cstring. Occurrences that are formed by removing another one
+ * @are removed as well. The string is only scanned once.
  * @description
  *
  * @example
@@ -0,0 +1,283 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * This file is the forkserver that tests link to, so that a test with many
+ * testcases only starts up once, rather than once for every testcase. It
+ * only uses the C library, so that it can be built into a test on its own.
+ *
+ * The forkserver reads requests from catalyst through its control socket,
+ * and forks a waiter for each of them. The waiter forks the test, tells
+ * catalyst its pid, and tells catalyst its status once it exits. The test
+ * waits for catalyst to place it and limit it before it goes on, and then
+ * returns from catalyst_forkserver into the main of the test.
+*/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#include "forkserver.h"
+
+/* The same as in testing.h, which cannot be included from a test */
+#define SCRATCH_VARIABLE    "CATALYST_SCRATCH"
+
+/* Which descriptor of a request is which */
+#define REQUEST_INPUT       0
+#define REQUEST_OUTPUT      1
+#define REQUEST_REPLY       2
+
+static char request[CATALYST_FORKSERVER_REQUEST_LENGTH + 1];
+
+/* The handling of the signals that the forkserver changes, which the
+ * test gets back. */
+static void (*child_handler)(int) = SIG_DFL;
+static void (*pipe_handler)(int) = SIG_DFL;
+
+static void close_descriptors(int *descriptors, int length) {
+    int index = 0;
+
+    for(index = 0; index < length; index++) {
+        close(descriptors[index]);
+    }
+}
+
+/*
+ * Wait for the next request, and return its length, or -1 when catalyst
+ * has closed the control socket. A request that did not come whole, with
+ * all of its descriptors, is passed over.
+*/
+static int receive_request(int control, int descriptors[CATALYST_FORKSERVER_DESCRIPTORS]) {
+    while(1) {
+        int length = 0;
+        int received = 0;
+        struct iovec vector;
+        struct msghdr message;
+        struct cmsghdr *header = NULL;
+        union {
+            struct cmsghdr header;
+            char buffer[CMSG_SPACE(sizeof(int) * CATALYST_FORKSERVER_DESCRIPTORS)];
+        } ancillary;
+
+        memset(&message, 0, sizeof(message));
+        vector.iov_base = request;
+        vector.iov_len = CATALYST_FORKSERVER_REQUEST_LENGTH;
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        message.msg_control = ancillary.buffer;
+        message.msg_controllen = sizeof(ancillary.buffer);
+
+        if((length = (int) recvmsg(control, &message, 0)) == -1 && errno == EINTR)
+            continue;
+
+        if(length <= 0)
+            return -1;
+
+        header = CMSG_FIRSTHDR(&message);
+
+        if(header != NULL && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            received = (int) ((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(descriptors, CMSG_DATA(header), sizeof(int) * received);
+        }
+
+        if(received == CATALYST_FORKSERVER_DESCRIPTORS &&
+           (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) == 0) {
+            request[length] = '\0';
+
+            return length;
+        }
+
+        close_descriptors(descriptors, received);
+    }
+}
+
+/*
+ * Give the test the streams, working directory and arguments that
+ * catalyst asked for. The request is the scratch directory of the test,
+ * which is empty when it has none, and then its argv.
+*/
+static int start_test(int length, int descriptors[CATALYST_FORKSERVER_DESCRIPTORS],
+                      int *argc, char ***argv) {
+    int index = 0;
+    int arguments = 0;
+    char *cursor = request + strlen(request) + 1;
+    char **new_argv = NULL;
+
+    if(dup2(descriptors[REQUEST_INPUT], STDIN_FILENO) == -1 ||
+       dup2(descriptors[REQUEST_OUTPUT], STDOUT_FILENO) == -1 ||
+       dup2(descriptors[REQUEST_OUTPUT], STDERR_FILENO) == -1) {
+        return -1;
+    }
+
+    if(descriptors[REQUEST_INPUT] > STDERR_FILENO)
+        close(descriptors[REQUEST_INPUT]);
+
+    if(descriptors[REQUEST_OUTPUT] > STDERR_FILENO)
+        close(descriptors[REQUEST_OUTPUT]);
+
+    if(request[0] != '\0') {
+        if(chdir(request) == -1)
+            return -1;
+
+        setenv(SCRATCH_VARIABLE, request, 1);
+    }
+
+    for(index = (int) (cursor - request); index < length; index++) {
+        arguments += request[index] == '\0';
+    }
+
+    if((new_argv = malloc((arguments + 1) * sizeof(char *))) == NULL)
+        return -1;
+
+    for(index = 0; index < arguments; index++) {
+        new_argv[index] = cursor;
+        cursor += strlen(cursor) + 1;
+    }
+
+    new_argv[arguments] = NULL;
+    *argc = arguments;
+    *argv = new_argv;
+
+    return 0;
+}
+
+static void send_reply(int descriptor, struct CatalystForkserverReply reply) {
+    while(send(descriptor, &reply, sizeof(reply), 0) == -1 && errno == EINTR);
+}
+
+/*
+ * Run in the waiter that was forked for a request. This only returns in
+ * the test, and the waiter exits once the test has.
+*/
+static void serve_request(int length, int descriptors[CATALYST_FORKSERVER_DESCRIPTORS],
+                          int *argc, char ***argv) {
+    int test = 0;
+    int status = 0;
+    int received = 0;
+    char start = 0;
+    struct CatalystForkserverReply reply;
+
+    /* The waiter waits for its test, which the forkserver does not */
+    signal(SIGCHLD, SIG_DFL);
+
+    if((test = fork()) == 0) {
+        signal(SIGCHLD, child_handler);
+        signal(SIGPIPE, pipe_handler);
+        setpgid(0, 0);
+
+        /* Catalyst lets the test go on once it has been placed */
+        while((received = (int) read(descriptors[REQUEST_REPLY], &start, 1)) == -1 && errno == EINTR);
+
+        if(received != 1)
+            _exit(EXIT_FAILURE);
+
+        close(descriptors[REQUEST_REPLY]);
+
+        if(start_test(length, descriptors, argc, argv) == -1)
+            _exit(EXIT_FAILURE);
+
+        return;
+    }
+
+    /* The group is made by both processes, so that it exists before
+     * catalyst can kill it. A pid of -1 tells catalyst the fork failed. */
+    memset(&reply, 0, sizeof(reply));
+    reply.pid = test;
+
+    if(test != -1)
+        setpgid(test, test);
+
+    send_reply(descriptors[REQUEST_REPLY], reply);
+    close(descriptors[REQUEST_INPUT]);
+    close(descriptors[REQUEST_OUTPUT]);
+
+    if(test == -1)
+        _exit(EXIT_FAILURE);
+
+    while(waitpid(test, &status, 0) == -1 && errno == EINTR);
+
+    /* The waiter has no other children, so their usage is the test's */
+    reply.status = status;
+    getrusage(RUSAGE_CHILDREN, &reply.usage);
+    send_reply(descriptors[REQUEST_REPLY], reply);
+
+    _exit(EXIT_SUCCESS);
+}
+
+void catalyst_forkserver(int *argc, char ***argv) {
+    int length = 0;
+    int control = 0;
+    int descriptors[CATALYST_FORKSERVER_DESCRIPTORS];
+    const char *variable = getenv(CATALYST_FORKSERVER_VARIABLE);
+
+    if(variable == NULL)
+        return;
+
+    /* Tests that the test starts are not forkservers themselves */
+    control = atoi(variable);
+    unsetenv(CATALYST_FORKSERVER_VARIABLE);
+
+    /* Waiters are reaped without being waited for, and a waiter whose
+     * runner is gone just exits when it replies. */
+    child_handler = signal(SIGCHLD, SIG_IGN);
+    pipe_handler = signal(SIGPIPE, SIG_IGN);
+
+    while((length = receive_request(control, descriptors)) != -1) {
+        switch(fork()) {
+            case 0:
+                close(control);
+                serve_request(length, descriptors, argc, argv);
+
+                return;
+        }
+
+        /* A request that could not be forked for is answered by closing
+         * its socket, which catalyst sees as the forkserver being gone. */
+        close_descriptors(descriptors, CATALYST_FORKSERVER_DESCRIPTORS);
+    }
+
+    exit(EXIT_SUCCESS);
+}
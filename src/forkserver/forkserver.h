@@ -0,0 +1,108 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CWARE_CATALYST_FORKSERVER_H
+#define CWARE_CATALYST_FORKSERVER_H
+
+#include <sys/resource.h>
+
+/* A test is started as a forkserver when this variable holds the
+ * descriptor of its control socket. */
+#define CATALYST_FORKSERVER_VARIABLE    "CATALYST_FORKSERVER"
+
+/* The longest request that a forkserver takes, which is the scratch
+ * directory of the test and its argv, each ended by a NUL. */
+#define CATALYST_FORKSERVER_REQUEST_LENGTH  32768
+
+/* Each request comes with the stdin of the test, the pipe its stdout
+ * and stderr go to, and the socket that it is answered through. */
+#define CATALYST_FORKSERVER_DESCRIPTORS     3
+
+/*
+ * @docgen: structure
+ * @brief: what a forkserver tells catalyst about a test it forked
+ * @name: CatalystForkserverReply
+ *
+ * @description
+ * @A forkserver replies to each request twice through the socket that
+ * @came with it. The first reply has the pid of the test, which is the
+ * @leader of its own process group. The second has its wait status and
+ * @resource usage, once it has exited.
+ * @description
+ *
+ * @field pid: the pid of the test
+ * @type: int
+ *
+ * @field status: the wait status of the test
+ * @type: int
+ *
+ * @field usage: the resource usage of the test
+ * @type: struct rusage
+*/
+struct CatalystForkserverReply {
+    int pid;
+    int status;
+    struct rusage usage;
+};
+
+/*
+ * @docgen: function
+ * @brief: run a test as a forkserver
+ * @name: catalyst_forkserver
+ *
+ * @include: forkserver.h
+ *
+ * @description
+ * @This function should be called at the top of the main of a test that
+ * @has the forkserver key, after anything that every testcase of it would
+ * @do at startup. When catalyst did not start the test as a forkserver,
+ * @it returns straight away. Otherwise, it never returns in the process
+ * @it was called in. The test waits for catalyst to ask for a testcase,
+ * @and forks for each one. It returns in the fork, with argc and argv
+ * @changed to those of the testcase, and its stdin, stdout and stderr and
+ * @working directory set up for it.
+ * @description
+ *
+ * @param argc: the argc of main
+ * @type: int *
+ *
+ * @param argv: the argv of main
+ * @type: char ***
+*/
+void catalyst_forkserver(int *argc, char ***argv);
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * This file starts the forkservers of tests that have one, and asks them
+ * for testcases. A forkserver is a test that was started once, and forks
+ * itself for each of its testcases, so that it only pays for starting up
+ * once. The other end of all of this is in src/forkserver.
+ *
+ * A test is placed and limited by its runner after it has been forked, so
+ * forkservers are only started on Linux, where resource limits can be set
+ * for another process. Everywhere else, every test is executed.
+*/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "jobs.h"
+#include "../catalyst.h"
+#include "../forkserver/forkserver.h"
+
+/* Only Linux has forkservers, but the rest still has to build */
+#ifndef SOCK_CLOEXEC
+#define SOCK_CLOEXEC    0
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL    0
+#endif
+
+#ifndef MSG_DONTWAIT
+#define MSG_DONTWAIT    0
+#endif
+
+int forkserver_start(const char *path, int *pid) {
+#if defined(__linux__)
+    int sockets[2];
+    char *argv[2] = {NULL, NULL};
+    char number[32 + 1] = "";
+    struct CString test_path = cstring_init("");
+
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1)
+        return -1;
+
+    cstring_concats(&test_path, TESTS_DIRECTORY);
+    cstring_concats(&test_path, LIBPATH_SEPARATOR);
+    cstring_concats(&test_path, path);
+
+    switch((*pid = fork())) {
+        case 0: {
+            int null = open("/dev/null", O_RDWR);
+
+            /* Whatever the test writes while it starts up belongs to
+             * none of its testcases. */
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+
+            if(null > STDERR_FILENO)
+                close(null);
+
+            /* The forkserver keeps its end of the control socket */
+            fcntl(sockets[1], F_SETFD, 0);
+            libc99_snprintf(number, 32, "%i", sockets[1]);
+            setenv(CATALYST_FORKSERVER_VARIABLE, number, 1);
+
+            restore_descriptor_limit();
+            argv[0] = test_path.contents;
+            execv(test_path.contents, argv);
+            _exit(EXIT_FAILURE);
+        }
+        case -1:
+            close(sockets[0]);
+            close(sockets[1]);
+            cstring_free(test_path);
+
+            return -1;
+    }
+
+    close(sockets[1]);
+    cstring_free(test_path);
+
+    return sockets[0];
+#else
+    *pid = -1;
+
+    return -1;
+#endif
+}
+
+void forkserver_stop(struct Forkserver server) {
+    /* A test that never called catalyst_forkserver may still be running,
+     * and nothing else would ever stop it. */
+    if(server.pid > 0)
+        kill(server.pid, SIGKILL);
+}
+
+/*
+ * Wait for the pid of the test until the timeout of the testcase, which
+ * is 0 for none. The root times the testcase out on its own, but that
+ * only kills the test once there is one, so a forkserver that never forks
+ * it, like a test that never calls catalyst_forkserver, would otherwise
+ * hold the runner up for as long as it runs.
+*/
+static int reply_arrived(int reply, int timeout) {
+    int waited = 0;
+    int remaining = timeout == 0 ? -1 : timeout;
+    struct pollfd descriptor;
+    struct timespec started;
+    struct timespec now;
+
+    descriptor.fd = reply;
+    descriptor.events = POLLIN;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    while((waited = poll(&descriptor, 1, remaining)) == -1 && errno == EINTR) {
+        if(timeout == 0)
+            continue;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        remaining = timeout - (int) ((now.tv_sec - started.tv_sec) * 1000 +
+                                     (now.tv_nsec - started.tv_nsec) / 1000000);
+
+        if(remaining < 0)
+            remaining = 0;
+    }
+
+    return waited > 0;
+}
+
+int forkserver_fork(int control, const char *request, int length, int input, int output,
+                    int timeout, int *pid) {
+    int sent = 0;
+    int received = 0;
+    int sockets[2];
+    int descriptors[CATALYST_FORKSERVER_DESCRIPTORS];
+    struct iovec vector;
+    struct msghdr message;
+    struct cmsghdr *header = NULL;
+    struct CatalystForkserverReply reply;
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * CATALYST_FORKSERVER_DESCRIPTORS)];
+    } ancillary;
+
+    if(control == -1 || length > CATALYST_FORKSERVER_REQUEST_LENGTH)
+        return -1;
+
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1)
+        liberror_failure(forkserver_fork, socketpair);
+
+    descriptors[0] = input;
+    descriptors[1] = output;
+    descriptors[2] = sockets[1];
+
+    INIT_VARIABLE(message);
+    INIT_VARIABLE(ancillary);
+    vector.iov_base = (void *) request;
+    vector.iov_len = length;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = ancillary.buffer;
+    message.msg_controllen = sizeof(ancillary.buffer);
+
+    header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(descriptors));
+    memcpy(CMSG_DATA(header), descriptors, sizeof(descriptors));
+
+    /* A forkserver that has exited cannot take the request, which must
+     * not kill the runner with SIGPIPE. One that is not taking requests
+     * and has a full socket cannot either. */
+    while((sent = (int) sendmsg(control, &message, MSG_NOSIGNAL | MSG_DONTWAIT)) == -1 &&
+          errno == EINTR);
+
+    close(sockets[1]);
+
+    /* The first reply is the pid of the test. A forkserver that goes away
+     * before it is sent closes the socket instead. */
+    if(sent != -1 && reply_arrived(sockets[0], timeout) == 0) {
+        close(sockets[0]);
+        *pid = -1;
+
+        return -1;
+    }
+
+    if(sent != -1)
+        while((received = (int) recv(sockets[0], &reply, sizeof(reply), 0)) == -1 && errno == EINTR);
+
+    if(sent == -1 || received != sizeof(reply) || reply.pid <= 0) {
+        close(sockets[0]);
+
+        return -1;
+    }
+
+    *pid = reply.pid;
+
+    return sockets[0];
+}
+
+void forkserver_release(int reply) {
+    send(reply, "", 1, MSG_NOSIGNAL);
+}
+
+int forkserver_wait(int reply, int *status, struct rusage *usage) {
+    int received = 0;
+    struct CatalystForkserverReply message;
+
+    if((received = (int) recv(reply, &message, sizeof(message), MSG_DONTWAIT)) == -1) {
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
+
+        liberror_failure(forkserver_wait, recv);
+    }
+
+    /* The waiter of the test was killed before it could say how the test
+     * exited, which is taken as the test being killed along with it. */
+    if(received != sizeof(message)) {
+        INIT_VARIABLE(*usage);
+        *status = SIGKILL;
+
+        return 1;
+    }
+
+    *status = message.status;
+    *usage = message.usage;
+
+    return 1;
+}
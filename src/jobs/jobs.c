@@ -41,13 +41,18 @@
  * can be found in src/testing.
 */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <poll.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdlib.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 
 #include "jobs.h"
 #include "../catalyst.h"
@@ -55,63 +60,122 @@
 #include "../parsers/parsers.h"
 #include "../testing/testing.h"
 
-void start_test_runners(struct PipePairs *pipes, struct Pollfds *descriptors,
-                        struct Configuration configuration) {
-    int index = 0;
+static const char *lost_runner_signal =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' lost its test "
+    "runner to signal %i\n";
+
+static const char *lost_runner_exit =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' ended without a "
+    "response (its test runner exited with %i)\n";
+
+/*
+ * Fork a test runner for one row of the testcase table, and return the
+ * end of the pipe that its response will come through.
+*/
+int start_test_runner(struct TestcaseTable table, struct Runners runners,
+                      struct Configuration configuration, int row) {
+    int pid = 0;
+    int fork_pipes[2];
+    struct PipePair pair;
+
+    /* Setup communication between root process and test runner. Test
+     * runners will notify the root process of the exit code, the file
+     * that was executed, and a string containing the reason it failed.
+     * The end of a response is the pipe closing, so the test must not
+     * be able to keep it open after the runner exits. */
+    if(cloexec_pipe(fork_pipes) == -1)
+        liberror_failure(start_test_runner, pipe);
+
+    pair.read = fork_pipes[0];
+    pair.write = fork_pipes[1];
+
+    /* Let the test runner do its thing. */
+    switch((pid = fork())) {
+        case 0: {
+            int index = 0;
+
+            /* The combination of a matrix testcase is only made, and
+             * named, once the runner has been forked. */
+            struct Testcase concrete = testcase_table_testcase(table, configuration, row);
+
+            /* The responses of the other runners are none of this one's
+             * business, and neither are their exits. */
+            for(index = 0; index < runners.length; index++) {
+                close(runners.descriptors[index].fd);
+            }
+
+            reaper_free(runners.reaper);
 
-    /* Run all tests (note that this does actually do any handling
-     * of the communication between the processes. It only readies
-     * the infrastructure to handle it. */
-    for(index = 0; index < carray_length(configuration.testcases); index++) {
-        int fork_pipes[2];
-        struct PipePair pair;
-        struct pollfd poll_segment;
-
-        /* Setup communication between root process and test runner */
-        pipe(fork_pipes);
-        pair.read = fork_pipes[0];
-        pair.write = fork_pipes[1];
-
-        /* Root process needs to wait for confirmation that the test
-         * has completed. Test runners will notify the root process
-         * of the exit code, the file that was executed, and a string
-         * containing the reason it failed. */
-        poll_segment.fd = pair.read;
-        poll_segment.events = POLLIN;
-
-        /* Let the test runner do its thing. */
-        switch(fork()) {
-            case 0: 
-                /* Test runner has access to a bunch of stuff due to
-                 * the need to release heap memory, and access IPC
-                 * interfaces. */
-                handle_testcase(configuration.testcases->contents[index], pair);
-                
-                /* Cleanup the cloned memory */
-                free_configuration(configuration);
-                carray_free(pipes, PIPE_PAIR);
-                carray_free(descriptors, POLLFD);
-
-                exit(EXIT_SUCCESS);
-            case -1:
-                liberror_failure(handle_jobs, fork);
-
-                exit(EXIT_FAILURE);
+            /* Test runner has access to a bunch of stuff due to
+             * the need to release heap memory, and access IPC
+             * interfaces. */
+            close(pair.read);
+            handle_testcase(concrete, pair, &runners.placement, row, table.inputs[row],
+                            table.forkservers[row]);
+
+            /* Cleanup the cloned memory */
+            testcase_table_release(table, configuration, row, concrete);
+            free_configuration(configuration);
+            testcase_table_free(table);
+            free(runners.descriptors);
+            free(runners.rows);
+            placement_free(runners.placement);
+
+            exit(EXIT_SUCCESS);
         }
+        case -1:
+            liberror_failure(start_test_runner, fork);
 
-        carray_append(pipes, pair, PIPE_PAIR);
-        carray_append(descriptors, poll_segment, POLLFD);
+            exit(EXIT_FAILURE);
     }
+
+    /* Only the runner writes, so that its pipe is closed once it exits */
+    close(pair.write);
+    table.pids[row] = pid;
+
+    return pair.read;
 }
 
-void wait_for_completion(struct Pollfds descriptors) {
-    int responses = 0;
+void start_test_runners(struct TestcaseTable table, struct Runners *runners,
+                        struct LibprocTimers *timers, struct Configuration configuration,
+                        int *next) {
+    /* Rows are started in the order of the table, which puts the most
+     * costly ones first, until there are as many running as there can
+     * be at once. */
+    while(runners->length < runners->limit && *next < table.length) {
+        int row = table.order[*next];
+        struct pollfd *descriptor = runners->descriptors + runners->length;
 
-    while(responses != carray_length(&descriptors)) {
-        responses = poll(descriptors.contents, carray_length(&descriptors), PROCESS_CHECK_TIMEOUT);
+        /* The next row waits for enough cpus to be free, rather than
+         * letting smaller rows behind it starve it. */
+        if(placement_claim(runners->placement, row, table.cpus[row]) == 0)
+            break;
 
-        if(responses > 0) 
-            continue;
+        descriptor->fd = start_test_runner(table, *runners, configuration, row);
+        descriptor->events = POLLIN;
+        descriptor->revents = 0;
+
+        reaper_watch(&runners->reaper, table.pids[row], row);
+        runners->rows[runners->length] = row;
+        runners->length++;
+        table.states[row] = TESTCASE_RUNNING;
+        (*next)++;
+
+        if(table.timeouts[row] != 0)
+            libproc_timer_start(timers, table.deadlines + row, table.timeouts[row]);
+    }
+}
+
+void wait_for_completion(struct Runners runners, struct LibprocTimers *timers) {
+    struct pollfd *reaper = runners.descriptors + runners.length;
+
+    /* Sleep until a runner responds or exits, or the next timeout is
+     * due. The reaper goes in the spare slot after the runners. */
+    reaper->fd = runners.reaper.descriptor;
+    reaper->events = POLLIN;
+    reaper->revents = 0;
+
+    while(poll(runners.descriptors, runners.length + 1, libproc_timers_next(timers)) == -1) {
 
         /* Interruption- This is an unavoidable error at times, so
          * keep going. */
@@ -126,34 +190,244 @@ void wait_for_completion(struct Pollfds descriptors) {
     }
 }
 
-void process_responses(struct PipePairs pipes) {
+/*
+ * A runner that died before it could finish its response is reported in
+ * place of the response.
+*/
+static void lost_runner_test(struct TestcaseTable table, struct Configuration configuration,
+                             int row) {
+    int status = table.statuses[row];
+    struct Testcase testcase;
+    char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
+
+    if(table.responses[row].contents == NULL)
+        table.responses[row] = cstring_init("");
+
+    if(WIFSIGNALED(status) == 0 && table.responses[row].length > 0)
+        return;
+
+    testcase = testcase_table_testcase(table, configuration, row);
+
+    if(WIFSIGNALED(status)) {
+        libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, lost_runner_signal,
+                        testcase.name.contents, testcase.path.contents, WTERMSIG(status));
+    } else {
+        libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, lost_runner_exit,
+                        testcase.name.contents, testcase.path.contents, WEXITSTATUS(status));
+    }
+
+    cstring_concats(table.responses + row, buffer);
+    testcase_table_release(table, configuration, row, testcase);
+}
+
+/*
+ * A row is done once its runner has closed its pipe and been reaped,
+ * in whichever order that happens.
+*/
+static void settle_row(struct TestcaseTable table, struct Configuration configuration,
+                       int row, int state) {
+    if(table.states[row] == TESTCASE_RUNNING) {
+        table.states[row] = state;
+
+        return;
+    }
+
+    table.states[row] = TESTCASE_DONE;
+    lost_runner_test(table, configuration, row);
+}
+
+void process_responses(struct TestcaseTable table, struct Runners *runners,
+                       struct LibprocTimers *timers, struct Configuration configuration) {
     int index = 0;
 
-    for(index = 0; index < carray_length(&pipes); index++) {
+    /* Go backwards, so that a finished runner can be replaced by the
+     * last one without skipping it. */
+    for(index = runners->length - 1; index >= 0; index--) {
+        int length = 0;
+        int row = runners->rows[index];
         char response[PROCESS_RESPONSE_LENGTH + 1] = "";
 
-        /* Read the response */
+        if(runners->descriptors[index].revents == 0)
+            continue;
+
+        /* A response can come in more than one piece, and it is over
+         * when the runner exits and its pipe is closed. A runner that
+         * died without one just leaves the pipe closed. */
         INIT_VARIABLE(response);
-        read(pipes.contents[index].read, response, PROCESS_RESPONSE_LENGTH);
 
-        printf("%s", response);
+        if((length = read(runners->descriptors[index].fd, response, PROCESS_RESPONSE_LENGTH)) == -1) {
+            if(errno == EINTR)
+                continue;
+
+            liberror_failure(process_responses, read);
+        }
+
+        if(table.responses[row].contents == NULL)
+            table.responses[row] = cstring_init("");
+
+        if(length > 0) {
+            response[length] = '\0';
+            cstring_concats(table.responses + row, response);
+
+            continue;
+        }
+
+        close(runners->descriptors[index].fd);
+        libproc_timer_cancel(timers, table.deadlines + row);
+        placement_release(runners->placement, row);
+        settle_row(table, configuration, row, TESTCASE_RESPONDED);
+
+        runners->length--;
+        runners->descriptors[index] = runners->descriptors[runners->length];
+        runners->rows[index] = runners->rows[runners->length];
+    }
+}
+
+void reap_test_runners(struct TestcaseTable table, struct Runners *runners,
+                       struct LibprocTimers *timers, struct Configuration configuration) {
+    int row = 0;
+    int status = 0;
+    struct rusage usage;
+
+    /* A reaped runner cannot be told that it is out of time, as its pid
+     * can belong to something else now. */
+    while(reaper_collect(&runners->reaper, &row, &status, &usage) == 1) {
+        table.statuses[row] = status;
+        table.usages[row] = usage;
+        libproc_timer_cancel(timers, table.deadlines + row);
+        settle_row(table, configuration, row, TESTCASE_EXITED);
+    }
+}
+
+void expire_test_runners(struct TestcaseTable table, struct LibprocTimers *timers) {
+    struct LibprocTimer *timer = libproc_timers_expire(timers);
+
+    /* Runners that are out of time are told so, and they kill their
+     * test and respond with the timeout. Responses are processed before
+     * this, so a runner that is told has not finished yet. */
+    while(timer != NULL) {
+        int row = (int) (timer - table.deadlines);
+
+        timer = timer->next;
+
+        if(kill(table.pids[row], TESTCASE_TIMEOUT_SIGNAL) == -1 && errno != ESRCH)
+            liberror_failure(expire_test_runners, kill);
+    }
+}
+
+void print_responses(struct TestcaseTable table, int *printed) {
+    /* Responses are printed in the order of the configuration, so rows
+     * that finished early wait for the ones before them. */
+    while(*printed < table.length && table.states[*printed] == TESTCASE_DONE) {
+        printf("%s", table.responses[*printed].contents);
+        cstring_free(table.responses[*printed]);
+
+        table.responses[*printed].contents = NULL;
+        (*printed)++;
+    }
+
+    fflush(stdout);
+}
+
+/*
+ * The root holds the response pipe of every runner that is running, so
+ * the number of runners is held to the descriptors it can open, beside
+ * the ones it already holds. The soft limit is raised as far as it can
+ * be first, for the root only-- the limit it was given is kept so that
+ * tests are put back under it before they run.
+ *
+ * This is a cap that is worked out once, before any runner starts. It
+ * only has to cover the root's own descriptors, as the pipes, scratch
+ * directories and stdin files of a runner are opened in the runner,
+ * which has a descriptor table of its own.
+*/
+static struct rlimit descriptor_limit;
+static int descriptor_limit_raised = 0;
+
+int descriptor_budget(int held) {
+    struct rlimit limit;
+
+    if(getrlimit(RLIMIT_NOFILE, &limit) == -1)
+        liberror_failure(descriptor_budget, getrlimit);
+
+    descriptor_limit = limit;
+
+    if(limit.rlim_max != RLIM_INFINITY && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+
+        if(setrlimit(RLIMIT_NOFILE, &limit) == -1)
+            getrlimit(RLIMIT_NOFILE, &limit);
+        else
+            descriptor_limit_raised = 1;
     }
+
+    if(limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > INT_MAX)
+        return INT_MAX / RUNNER_DESCRIPTORS;
+
+    if((int) limit.rlim_cur <= RESERVED_DESCRIPTORS + held + RUNNER_DESCRIPTORS)
+        return 1;
+
+    return ((int) limit.rlim_cur - RESERVED_DESCRIPTORS - held) / RUNNER_DESCRIPTORS;
 }
 
-void handle_jobs(struct Configuration configuration) {
-    struct PipePairs *pipes = NULL;
-    struct Pollfds *descriptors = NULL;
-
-    pipes = carray_init(pipes, PIPE_PAIR);
-    descriptors = carray_init(descriptors, POLLFD);
-    
-    /* Spawn test runners to run their tests, wait for the tests to finish,
-     * and read the responses from the test runners. */
-    start_test_runners(pipes, descriptors, configuration);
-    wait_for_completion(*descriptors);
-    process_responses(*pipes);
-
-    /* File descriptors are closed in the pipe array releasing function */
-    carray_free(pipes, PIPE_PAIR);
-    carray_free(descriptors, POLLFD);
+void restore_descriptor_limit(void) {
+    if(descriptor_limit_raised == 0)
+        return;
+
+    if(setrlimit(RLIMIT_NOFILE, &descriptor_limit) == -1)
+        liberror_failure(restore_descriptor_limit, setrlimit);
+}
+
+void handle_jobs(struct Configuration configuration, int limit) {
+    int next = 0;
+    int printed = 0;
+    int budget = 0;
+    sigset_t signals;
+    struct Runners runners;
+    struct LibprocTimers timers;
+    struct TestcaseTable table = testcase_table_init(configuration);
+
+    runners.length = 0;
+    runners.limit = limit;
+
+    if(runners.limit <= 0 || runners.limit > table.length)
+        runners.limit = table.length;
+
+    /* The sealed stdin files and forkservers of the table are held for
+     * the whole run */
+    budget = descriptor_budget(chashmap_length(table.input_files) +
+                               chashmap_length(table.forkserver_tests));
+
+    if(runners.limit > budget)
+        runners.limit = budget;
+
+    runners.descriptors = malloc((runners.limit + 1) * sizeof(*runners.descriptors));
+    runners.rows = malloc((runners.limit + 1) * sizeof(*runners.rows));
+    runners.placement = placement_init();
+    runners.reaper = reaper_init();
+    libproc_timers_init(&timers);
+
+    /* Runners wait for the timeout signal from the start, even before
+     * they can handle it, so that it is never lost. */
+    sigemptyset(&signals);
+    sigaddset(&signals, TESTCASE_TIMEOUT_SIGNAL);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    /* Keep as many test runners going as there can be, and print their
+     * responses as they come in. */
+    while(printed < table.length) {
+        start_test_runners(table, &runners, &timers, configuration, &next);
+        wait_for_completion(runners, &timers);
+        process_responses(table, &runners, &timers, configuration);
+        reap_test_runners(table, &runners, &timers, configuration);
+        expire_test_runners(table, &timers);
+        print_responses(table, &printed);
+    }
+
+    testcase_table_stop(table);
+    testcase_table_free(table);
+    free(runners.descriptors);
+    free(runners.rows);
+    placement_free(runners.placement);
+    reaper_free(runners.reaper);
 }
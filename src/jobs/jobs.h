@@ -38,11 +38,22 @@
 #ifndef CWARE_CATALYST_JOBS_H
 #define CWARE_CATALYST_JOBS_H
 
+struct rusage;
+struct Testcase;
 struct Configuration;
+struct LibprocTimer;
 
-#define PROCESS_CHECK_TIMEOUT   500
 #define PROCESS_RESPONSE_LENGTH 2048 + 1
 
+/* The root holds this many descriptors for each running test runner,
+ * and keeps this many free for everything else. */
+#define RUNNER_DESCRIPTORS      1
+#define RESERVED_DESCRIPTORS    16
+
+/* The root process tells a test runner that its test is out of time
+ * with this signal. */
+#define TESTCASE_TIMEOUT_SIGNAL SIGALRM
+
 /*
  * @docgen: structure
  * @brief: pair of pipes for reading and writing
@@ -59,56 +70,794 @@ struct PipePair {
     int write;
 };
 
+/* Data structure properties */
+#define INPUT_FILE_TYPE                 struct InputFile
+#define INPUT_FILE_HEAP                 1
+#define INPUT_FILE_FREE(value)          close((value).descriptor)
+#define INPUT_FILE_HASH(value)          hash_bytes((value).contents, (value).length)
+#define INPUT_FILE_COMPARE(a, b)        \
+    ((a).length == (b).length && \
+     ((a).contents == (b).contents || memcmp((a).contents, (b).contents, (a).length) == 0))
+
 /*
  * @docgen: structure
- * @brief: array of pipes
- * @name: PipePairs
+ * @brief: a stdin that has been written to a sealed file
+ * @name: InputFile
+ *
+ * @field contents: the bytes of the stdin
+ * @type: const char *
  *
- * @field length: the length of the array
+ * @field length: the number of bytes in the stdin
  * @type: int
  *
- * @field capacity: the capacity of the array
+ * @field descriptor: the sealed file holding it
+ * @type: int
+*/
+struct InputFile {
+    const char *contents;
+    int length;
+    int descriptor;
+};
+
+/*
+ * @docgen: structure
+ * @brief: table of the sealed files of each distinct stdin
+ * @name: InputFiles
+ *
+ * @field length: the number of files in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
  * @type: int
  *
- * @field contents: the pipes in the array
- * @type: struct PipePair
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the files
+ * @type: struct InputFile *
 */
-struct PipePairs {
+struct InputFiles {
     int length;
+    int used;
     int capacity;
-    struct PipePair *contents;
+    unsigned char *states;
+    struct InputFile *contents;
 };
 
+/* Data structure properties */
+#define FORKSERVER_TYPE                 struct Forkserver
+#define FORKSERVER_HEAP                 1
+#define FORKSERVER_FREE(value)          \
+    ((value).descriptor == -1 ? 0 : close((value).descriptor))
+#define FORKSERVER_HASH(value)          hash_bytes((value).path, (value).length)
+#define FORKSERVER_COMPARE(a, b)        \
+    ((a).length == (b).length && \
+     ((a).path == (b).path || memcmp((a).path, (b).path, (a).length) == 0))
+
 /*
  * @docgen: structure
- * @brief: an array of integers
- * @name: IntArray
+ * @brief: a test that was started as a forkserver
+ * @name: Forkserver
+ *
+ * @field path: the path to the test, under the tests directory
+ * @type: const char *
  *
- * @field length: the length of the array
+ * @field length: the length of the path
  * @type: int
  *
- * @field capacity: the capacity of the array
+ * @field descriptor: the control socket of the forkserver, or -1
  * @type: int
  *
- * @field contents: the pollfds in the array
- * @type: struct pollfd *
+ * @field pid: the pid of the forkserver, or -1
+ * @type: int
+*/
+struct Forkserver {
+    const char *path;
+    int length;
+    int descriptor;
+    int pid;
+};
+
+/*
+ * @docgen: structure
+ * @brief: table of the forkservers of each distinct test
+ * @name: Forkservers
+ *
+ * @field length: the number of forkservers in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
+ * @type: int
+ *
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the forkservers
+ * @type: struct Forkserver *
 */
-struct Pollfds {
+struct Forkservers {
     int length;
+    int used;
     int capacity;
-    struct pollfd *contents;
+    unsigned char *states;
+    struct Forkserver *contents;
+};
+
+/*
+ * The states of a concrete testcase in the testcase table. A row is done
+ * once its runner has both closed its pipe and been reaped, which can
+ * happen in either order.
+*/
+#define TESTCASE_PENDING    0
+#define TESTCASE_RUNNING    1
+#define TESTCASE_RESPONDED  2
+#define TESTCASE_EXITED     3
+#define TESTCASE_DONE       4
+
+/* A testcase without a timeout is assumed to take this long (in
+ * milliseconds) when ordering testcases by cost, and every this many
+ * bytes of input and expected output add a millisecond to it. */
+#define TESTCASE_DEFAULT_COST   1000
+#define TESTCASE_COST_BYTES     4096
+
+/*
+ * @docgen: structure
+ * @brief: a columnar table of concrete testcases
+ * @name: TestcaseTable
+ *
+ * @description
+ * @Every combination of every testcase is a row of the table, and every
+ * @field of a row is held in an array of its own, so the scheduler only
+ * @touches the columns that it needs. Everything else about a row, like
+ * @its input and expected output, stays out of line in the testcase that
+ * @the row was made from.
+ * @description
+ *
+ * @field length: the number of rows in the table
+ * @type: int
+ *
+ * @field ids: the testcase (in the configuration) of each row
+ * @type: int *
+ *
+ * @field variants: the combination of its testcase that each row is
+ * @type: int *
+ *
+ * @field timeouts: the timeout of each row, in milliseconds
+ * @type: int *
+ *
+ * @field cpus: the number of cpus each row is pinned to
+ * @type: int *
+ *
+ * @field states: the state of each row
+ * @type: unsigned char *
+ *
+ * @field costs: the estimated cost of each row
+ * @type: long *
+ *
+ * @field order: the rows, from the most to the least costly
+ * @type: int *
+ *
+ * @field pids: the test runner of each row that has been started
+ * @type: int *
+ *
+ * @field deadlines: the timer of each row, for rows with a timeout
+ * @type: struct LibprocTimer *
+ *
+ * @field responses: the response of each row's test runner
+ * @type: struct CString *
+ *
+ * @field statuses: the wait status of each row's test runner once it is reaped
+ * @type: int *
+ *
+ * @field usages: the resource usage of each row's test runner, and its test
+ * @type: struct rusage *
+ *
+ * @field inputs: the sealed file holding each row's stdin, or -1 for a pipe
+ * @type: int *
+ *
+ * @field input_files: the sealed file of each distinct stdin, shared by rows
+ * @type: struct InputFiles *
+ *
+ * @field forkservers: the control socket of each row's forkserver, or -1
+ * @type: int *
+ *
+ * @field forkserver_tests: the forkserver of each distinct test, shared by rows
+ * @type: struct Forkservers *
+*/
+struct TestcaseTable {
+    int length;
+    int *ids;
+    int *variants;
+    int *timeouts;
+    int *cpus;
+    unsigned char *states;
+    long *costs;
+    int *order;
+    int *pids;
+    struct LibprocTimer *deadlines;
+    struct CString *responses;
+    int *statuses;
+    struct rusage *usages;
+    int *inputs;
+    struct InputFiles *input_files;
+    int *forkservers;
+    struct Forkservers *forkserver_tests;
 };
 
 /* Data structure properties */
-#define PIPE_PAIR_TYPE  struct PipePair
-#define PIPE_PAIR_HEAP  1
-#define PIPE_PAIR_FREE(value) \
-    close((value).read);      \
-    close((value).write)
+#define REAPER_CHILD_TYPE               struct ReaperChild
+#define REAPER_CHILD_HEAP               1
+#define REAPER_CHILD_FREE(value)
+#define REAPER_CHILD_HASH(value)        ((unsigned long) (value).pid)
+#define REAPER_CHILD_COMPARE(a, b)      ((a).pid == (b).pid)
+
+/*
+ * @docgen: structure
+ * @brief: a child process that the reaper is waiting for
+ * @name: ReaperChild
+ *
+ * @field pid: the pid of the child
+ * @type: int
+ *
+ * @field row: the row of the testcase table that the child is running
+ * @type: int
+*/
+struct ReaperChild {
+    int pid;
+    int row;
+};
 
-#define POLLFD_TYPE  struct pollfd
-#define POLLFD_HEAP  1
-#define POLLFD_FREE(value)
+/*
+ * @docgen: structure
+ * @brief: table of the children that the reaper is waiting for by pid
+ * @name: ReaperChildren
+ *
+ * @field length: the number of children in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
+ * @type: int
+ *
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the children
+ * @type: struct ReaperChild *
+*/
+struct ReaperChildren {
+    int length;
+    int used;
+    int capacity;
+    unsigned char *states;
+    struct ReaperChild *contents;
+};
 
+/*
+ * @docgen: structure
+ * @brief: collects the children of the root process as they exit
+ * @name: Reaper
+ *
+ * @field descriptor: readable when a child has exited
+ * @type: int
+ *
+ * @field children: the children that have not been reaped yet
+ * @type: struct ReaperChildren *
+*/
+struct Reaper {
+    int descriptor;
+    struct ReaperChildren *children;
+};
+
+/*
+ * @docgen: structure
+ * @brief: the cpus that tests can be pinned to
+ * @name: Placement
+ *
+ * @field length: the number of cpus that tests can be pinned to
+ * @type: int
+ *
+ * @field reserved: the cpu that catalyst runs on, or -1
+ * @type: int
+ *
+ * @field cores: the cpus that tests can be pinned to
+ * @type: int *
+ *
+ * @field owners: the row pinned to each cpu, or -1
+ * @type: int *
+*/
+struct Placement {
+    int length;
+    int reserved;
+    int *cores;
+    int *owners;
+};
+
+/*
+ * @docgen: structure
+ * @brief: the test runners that are running
+ * @name: Runners
+ *
+ * @field length: the number of running test runners
+ * @type: int
+ *
+ * @field limit: the most test runners that can run at once
+ * @type: int
+ *
+ * @field descriptors: the read end of each runner's pipe
+ * @type: struct pollfd *
+ *
+ * @field rows: the row of the testcase table each runner is running
+ * @type: int *
+ *
+ * @field placement: the cpus that the runners' tests are pinned to
+ * @type: struct Placement
+ *
+ * @field reaper: collects the runners when they exit
+ * @type: struct Reaper
+*/
+struct Runners {
+    int length;
+    int limit;
+    struct pollfd *descriptors;
+    int *rows;
+    struct Placement placement;
+    struct Reaper reaper;
+};
+
+/*
+ * @docgen: function
+ * @brief: put a test back under the descriptor limit catalyst was given
+ * @name: restore_descriptor_limit
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @The root raises its soft limit on open descriptors so that it can
+ * @hold more runners. This function lowers it again to the limit that
+ * @catalyst was started with, and is called in a test, or a forkserver,
+ * @before it is executed, so that tests do not inherit the raised limit.
+ * @It does nothing when the limit was never raised.
+ * @description
+*/
+void restore_descriptor_limit(void);
+
+/*
+ * @docgen: function
+ * @brief: divide the cpus between catalyst and its tests
+ * @name: placement_init
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will pin catalyst to the first cpu that it is allowed
+ * @to run on, and keep the rest of them for tests. If there is only one
+ * @cpu, or cpus cannot be pinned, nothing is pinned and the placement
+ * @has no cpus in it.
+ * @description
+ *
+ * @return: the placement
+ * @type: struct Placement
+*/
+struct Placement placement_init(void);
+
+/*
+ * @docgen: function
+ * @brief: release a placement
+ * @name: placement_free
+ *
+ * @include: jobs.h
+ *
+ * @param placement: the placement to release
+ * @type: struct Placement
+*/
+void placement_free(struct Placement placement);
+
+/*
+ * @docgen: function
+ * @brief: claim cpus for a row of the testcase table
+ * @name: placement_claim
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will give a row as many free cpus as it asks for, or
+ * @every cpu if it asks for more than there are. A placement with no
+ * @cpus in it always succeeds.
+ * @description
+ *
+ * @param placement: the placement to claim from
+ * @type: struct Placement
+ *
+ * @param row: the row to claim the cpus for
+ * @type: int
+ *
+ * @param cpus: the number of cpus to claim
+ * @type: int
+ *
+ * @return: 1 if the cpus were claimed, and 0 if not enough are free
+ * @type: int
+*/
+int placement_claim(struct Placement placement, int row, int cpus);
+
+/*
+ * @docgen: function
+ * @brief: release the cpus of a row of the testcase table
+ * @name: placement_release
+ *
+ * @include: jobs.h
+ *
+ * @param placement: the placement to release the cpus to
+ * @type: struct Placement
+ *
+ * @param row: the row to release the cpus of
+ * @type: int
+*/
+void placement_release(struct Placement placement, int row);
+
+/*
+ * @docgen: function
+ * @brief: move a test to the cpus of a row
+ * @name: placement_apply
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will pin a test to the cpus claimed for a row, and give
+ * @it the nice value and I/O priority of its testcase. It is called by a
+ * @test before its program is executed, with a pid of 0, or by the runner
+ * @of a test that was forked by a forkserver, with the pid of the test.
+ * @The nice value is relative to that of the calling process.
+ * @description
+ *
+ * @param placement: the placement the cpus were claimed from
+ * @type: struct Placement
+ *
+ * @param row: the row the cpus were claimed for
+ * @type: int
+ *
+ * @param testcase: the testcase of the row
+ * @type: struct Testcase
+ *
+ * @param pid: the test, or 0 for the calling process
+ * @type: int
+*/
+void placement_apply(struct Placement placement, int row, struct Testcase testcase, int pid);
+
+/*
+ * @docgen: function
+ * @brief: start a test as a forkserver
+ * @name: forkserver_start
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will execute a test with the control socket of a
+ * @forkserver, and nothing on its standard streams, so that it can start
+ * @up once and then fork for each of its testcases. Forkservers are only
+ * @started on Linux. A test that does not call catalyst_forkserver just
+ * @runs once with no arguments, and closes the socket when it exits.
+ * @description
+ *
+ * @param path: the path to the test, under the tests directory
+ * @type: const char *
+ *
+ * @param pid: where to store the pid of the forkserver
+ * @type: int *
+ *
+ * @return: the control socket of the forkserver, or -1 if it could not be started
+ * @type: int
+*/
+int forkserver_start(const char *path, int *pid);
+
+/*
+ * @docgen: function
+ * @brief: stop a forkserver
+ * @name: forkserver_stop
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will kill a forkserver, in case it never started serving
+ * @and so would not exit on its own once its control socket is closed.
+ * @description
+ *
+ * @param server: the forkserver to stop
+ * @type: struct Forkserver
+*/
+void forkserver_stop(struct Forkserver server);
+
+/*
+ * @docgen: function
+ * @brief: ask a forkserver to fork a test
+ * @name: forkserver_fork
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will send a request to a forkserver, and wait for it to
+ * @fork the test. The request is the scratch directory of the test, which
+ * @is empty when it has none, and then its argv, with each of them ended
+ * @by a NUL. The test waits to be let go with forkserver_release, so that
+ * @it can be placed and limited first. When the forkserver is gone, or the
+ * @request is too long for it, the test has to be executed instead. A
+ * @forkserver that has not forked the test by the end of its timeout, such
+ * @as a test that never calls catalyst_forkserver and does not exit, has
+ * @timed the testcase out, which is told apart by the pid being -1.
+ * @description
+ *
+ * @param control: the control socket of the forkserver, or -1
+ * @type: int
+ *
+ * @param request: the request
+ * @type: const char *
+ *
+ * @param length: the length of the request
+ * @type: int
+ *
+ * @param input: the descriptor to give the test as its stdin
+ * @type: int
+ *
+ * @param output: the descriptor to give the test as its stdout and stderr
+ * @type: int
+ *
+ * @param timeout: the milliseconds to wait for the test to be forked, or 0 for no limit
+ * @type: int
+ *
+ * @param pid: where to put the pid of the test, or -1 if it timed out
+ * @type: int *
+ *
+ * @return: the socket that the test is answered through, or -1
+ * @type: int
+*/
+int forkserver_fork(int control, const char *request, int length, int input, int output,
+                    int timeout, int *pid);
+
+/*
+ * @docgen: function
+ * @brief: let a forked test go on
+ * @name: forkserver_release
+ *
+ * @include: jobs.h
+ *
+ * @param reply: the socket that the test is answered through
+ * @type: int
+*/
+void forkserver_release(int reply);
+
+/*
+ * @docgen: function
+ * @brief: find out whether a forked test has exited
+ * @name: forkserver_wait
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will take the wait status and resource usage of a test
+ * @that a forkserver forked, if it has exited, without blocking. The
+ * @socket that it is answered through becomes readable when it exits.
+ * @description
+ *
+ * @param reply: the socket that the test is answered through
+ * @type: int
+ *
+ * @param status: where to put the wait status of the test
+ * @type: int *
+ *
+ * @param usage: where to put the resource usage of the test
+ * @type: struct rusage *
+ *
+ * @return: 1 if the test has exited, and 0 if not
+ * @type: int
+*/
+int forkserver_wait(int reply, int *status, struct rusage *usage);
+
+/*
+ * @docgen: function
+ * @brief: start collecting the children of the calling process
+ * @name: reaper_init
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will make a reaper, whose descriptor becomes readable
+ * @when a child of the calling process exits, so that waiting for
+ * @children fits into a poll loop. On Linux, SIGCHLD is blocked and read
+ * @from a signalfd. Elsewhere, a handler for it writes to a pipe. It must
+ * @be called before any of the children are forked.
+ * @description
+ *
+ * @return: the reaper
+ * @type: struct Reaper
+*/
+struct Reaper reaper_init(void);
+
+/*
+ * @docgen: function
+ * @brief: stop collecting children
+ * @name: reaper_free
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will release a reaper, and give SIGCHLD back its
+ * @default handling. It is also how a forked child lets go of the reaper
+ * @of its parent.
+ * @description
+ *
+ * @param reaper: the reaper to release
+ * @type: struct Reaper
+*/
+void reaper_free(struct Reaper reaper);
+
+/*
+ * @docgen: function
+ * @brief: wait for a child as part of a row of the testcase table
+ * @name: reaper_watch
+ *
+ * @include: jobs.h
+ *
+ * @param reaper: the reaper to wait with
+ * @type: struct Reaper *
+ *
+ * @param pid: the child to wait for
+ * @type: int
+ *
+ * @param row: the row that the child is running
+ * @type: int
+*/
+void reaper_watch(struct Reaper *reaper, int pid, int row);
+
+/*
+ * @docgen: function
+ * @brief: collect a child that has exited
+ * @name: reaper_collect
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will reap one child that has exited without blocking,
+ * @and give back its row, its exact wait status and its resource usage.
+ * @It should be called until it returns 0 whenever the descriptor of the
+ * @reaper is readable. Children that were never watched are reaped and
+ * @passed over.
+ * @description
+ *
+ * @param reaper: the reaper to collect with
+ * @type: struct Reaper *
+ *
+ * @param row: where to put the row of the child
+ * @type: int *
+ *
+ * @param status: where to put the wait status of the child
+ * @type: int *
+ *
+ * @param usage: where to put the resource usage of the child
+ * @type: struct rusage *
+ *
+ * @return: 1 if a child was collected, and 0 if none has exited
+ * @type: int
+*/
+int reaper_collect(struct Reaper *reaper, int *row, int *status, struct rusage *usage);
+
+/*
+ * @docgen: function
+ * @brief: build the testcase table of a configuration
+ * @name: testcase_table_init
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will expand every testcase of the configuration into
+ * @its combinations, and make a pending row of the table for each of
+ * @them, in the order that they appear in the configuration.
+ * @description
+ *
+ * @param configuration: the configuration to take the testcases from
+ * @type: struct Configuration
+ *
+ * @return: the testcase table
+ * @type: struct TestcaseTable
+*/
+struct TestcaseTable testcase_table_init(struct Configuration configuration);
+
+/*
+ * @docgen: function
+ * @brief: release the testcase table
+ * @name: testcase_table_free
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will release every column of the testcase table,
+ * @and the responses in it.
+ * @description
+ *
+ * @param table: the table to release
+ * @type: struct TestcaseTable
+*/
+void testcase_table_free(struct TestcaseTable table);
+
+/*
+ * @docgen: function
+ * @brief: stop the forkservers of the testcase table
+ * @name: testcase_table_stop
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will stop every forkserver that was started for the
+ * @table. Only the root does this, once every testcase is done, since
+ * @the runners share the forkservers.
+ * @description
+ *
+ * @param table: the table to stop the forkservers of
+ * @type: struct TestcaseTable
+*/
+void testcase_table_stop(struct TestcaseTable table);
+
+/*
+ * @docgen: function
+ * @brief: get the concrete testcase of a row
+ * @name: testcase_table_testcase
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will make the concrete testcase of a row of the table
+ * @from its cold data in the configuration. Matrix testcases are given
+ * @the name of their combination, which should be released with
+ * @testcase_table_release.
+ * @description
+ *
+ * @param table: the table to take the row from
+ * @type: struct TestcaseTable
+ *
+ * @param configuration: the configuration that the table was made from
+ * @type: struct Configuration
+ *
+ * @param row: the row to make the testcase of
+ * @type: int
+ *
+ * @return: the concrete testcase
+ * @type: struct Testcase
+*/
+struct Testcase testcase_table_testcase(struct TestcaseTable table,
+                                        struct Configuration configuration, int row);
+
+/*
+ * @docgen: function
+ * @brief: release a concrete testcase of a row
+ * @name: testcase_table_release
+ *
+ * @include: jobs.h
+ *
+ * @description
+ * @This function will release what testcase_table_testcase made for
+ * @the concrete testcase of a row.
+ * @description
+ *
+ * @param table: the table that the row is in
+ * @type: struct TestcaseTable
+ *
+ * @param configuration: the configuration that the table was made from
+ * @type: struct Configuration
+ *
+ * @param row: the row that the testcase was made from
+ * @type: int
+ *
+ * @param testcase: the concrete testcase
+ * @type: struct Testcase
+*/
+void testcase_table_release(struct TestcaseTable table, struct Configuration configuration,
+                            int row, struct Testcase testcase);
 
 #endif
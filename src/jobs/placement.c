@@ -0,0 +1,190 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * This file decides which cpus each running test is pinned to. Catalyst
+ * keeps the first cpu it is allowed to run on to itself, and hands out
+ * the rest to tests, so that a test never shares a core with another
+ * test or with catalyst. Where cpus cannot be pinned, or there is only
+ * one of them, every test is placed without being pinned.
+*/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "jobs.h"
+#include "../catalyst.h"
+#include "../parsers/parsers.h"
+
+#if defined(__linux__)
+#define IOPRIO_WHO_PROCESS      1
+#define IOPRIO_CLASS_BE         2
+#define IOPRIO_CLASS_SHIFT      13
+#endif
+
+struct Placement placement_init(void) {
+    struct Placement placement;
+#if defined(__linux__)
+    int cpu = 0;
+    cpu_set_t allowed;
+    cpu_set_t reserved;
+#endif
+
+    INIT_VARIABLE(placement);
+    placement.reserved = -1;
+
+#if defined(__linux__)
+    CPU_ZERO(&allowed);
+
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == -1 || CPU_COUNT(&allowed) < 2)
+        return placement;
+
+    placement.cores = malloc(sizeof(*placement.cores) * CPU_COUNT(&allowed));
+    placement.owners = malloc(sizeof(*placement.owners) * CPU_COUNT(&allowed));
+
+    for(cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if(CPU_ISSET(cpu, &allowed) == 0)
+            continue;
+
+        if(placement.reserved == -1) {
+            placement.reserved = cpu;
+
+            continue;
+        }
+
+        placement.cores[placement.length] = cpu;
+        placement.owners[placement.length] = -1;
+        placement.length++;
+    }
+
+    /* Test runners are forked from here, so they stay with catalyst
+     * until their test is placed. */
+    CPU_ZERO(&reserved);
+    CPU_SET(placement.reserved, &reserved);
+    sched_setaffinity(0, sizeof(reserved), &reserved);
+#endif
+
+    return placement;
+}
+
+void placement_free(struct Placement placement) {
+    free(placement.cores);
+    free(placement.owners);
+}
+
+int placement_claim(struct Placement placement, int row, int cpus) {
+    int index = 0;
+    int free_cores = 0;
+
+    if(placement.length == 0)
+        return 1;
+
+    /* A test cannot have more cores than there are */
+    if(cpus > placement.length)
+        cpus = placement.length;
+
+    for(index = 0; index < placement.length; index++) {
+        free_cores += placement.owners[index] == -1;
+    }
+
+    if(free_cores < cpus)
+        return 0;
+
+    for(index = 0; index < placement.length && cpus > 0; index++) {
+        if(placement.owners[index] != -1)
+            continue;
+
+        placement.owners[index] = row;
+        cpus--;
+    }
+
+    return 1;
+}
+
+void placement_release(struct Placement placement, int row) {
+    int index = 0;
+
+    for(index = 0; index < placement.length; index++) {
+        if(placement.owners[index] == row)
+            placement.owners[index] = -1;
+    }
+}
+
+void placement_apply(struct Placement placement, int row, struct Testcase testcase, int pid) {
+    int priority = 0;
+#if defined(__linux__)
+    int index = 0;
+    cpu_set_t cores;
+
+    CPU_ZERO(&cores);
+
+    for(index = 0; index < placement.length; index++) {
+        if(placement.owners[index] == row)
+            CPU_SET(placement.cores[index], &cores);
+    }
+
+    if(CPU_COUNT(&cores) > 0 && sched_setaffinity(pid, sizeof(cores), &cores) == -1)
+        liberror_failure(placement_apply, sched_setaffinity);
+
+    if(testcase.ionice != TESTCASE_NO_IONICE &&
+       syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid,
+               (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | testcase.ionice) == -1) {
+        liberror_failure(placement_apply, ioprio_set);
+    }
+#endif
+
+    if(testcase.nice == 0)
+        return;
+
+    /* A priority can be -1, so only errno tells whether getting it
+     * failed. The test is niced from where the runner is. */
+    errno = 0;
+
+    if((priority = getpriority(PRIO_PROCESS, 0)) == -1 && errno != 0)
+        liberror_failure(placement_apply, getpriority);
+
+    if(setpriority(PRIO_PROCESS, pid, priority + testcase.nice) == -1)
+        liberror_failure(placement_apply, setpriority);
+}
@@ -0,0 +1,181 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * This file collects the test runners of the root process as they exit.
+ * Exits are noticed through a descriptor that the scheduler polls along
+ * with the responses of the runners, so a runner is reaped by the same
+ * loop that reads its response, with its exact status and usage, and
+ * nothing else in the process can take the status out from under it.
+*/
+
+/* signalfd and wait4 are only declared for GNU code */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sys/signalfd.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "jobs.h"
+#include "../catalyst.h"
+#include "../common/common.h"
+
+#if !defined(__linux__)
+static int exit_pipe[2] = {-1, -1};
+
+static void handle_exit(int signal_number) {
+    int saved_errno = errno;
+
+    write(exit_pipe[1], "", 1);
+    errno = saved_errno;
+}
+#endif
+
+struct Reaper reaper_init(void) {
+    struct Reaper reaper;
+    sigset_t signals;
+#if !defined(__linux__)
+    struct sigaction action;
+#endif
+
+    INIT_VARIABLE(reaper);
+    reaper.children = chashmap_init(reaper.children, REAPER_CHILD);
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+
+#if defined(__linux__)
+    /* The signal is only ever read from the descriptor, so it is
+     * blocked before there are any children to send it. */
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    if((reaper.descriptor = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC)) == -1)
+        liberror_failure(reaper_init, signalfd);
+#else
+    if(cloexec_pipe(exit_pipe) == -1)
+        liberror_failure(reaper_init, pipe);
+
+    fcntl(exit_pipe[0], F_SETFL, fcntl(exit_pipe[0], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(exit_pipe[1], F_SETFL, fcntl(exit_pipe[1], F_GETFL, 0) | O_NONBLOCK);
+
+    INIT_VARIABLE(action);
+    action.sa_handler = handle_exit;
+    action.sa_flags = SA_NOCLDSTOP | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    reaper.descriptor = exit_pipe[0];
+#endif
+
+    return reaper;
+}
+
+void reaper_free(struct Reaper reaper) {
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+
+#if defined(__linux__)
+    close(reaper.descriptor);
+    sigprocmask(SIG_UNBLOCK, &signals, NULL);
+#else
+    signal(SIGCHLD, SIG_DFL);
+    close(exit_pipe[0]);
+    close(exit_pipe[1]);
+#endif
+
+    chashmap_free(reaper.children, REAPER_CHILD);
+}
+
+void reaper_watch(struct Reaper *reaper, int pid, int row) {
+    struct ReaperChild child;
+
+    liberror_is_null(reaper_watch, reaper);
+
+    child.pid = pid;
+    child.row = row;
+    chashmap_insert(reaper->children, child, REAPER_CHILD);
+}
+
+int reaper_collect(struct Reaper *reaper, int *row, int *status, struct rusage *usage) {
+    int pid = 0;
+    int location = 0;
+    char signals[256] = "";
+    struct ReaperChild child;
+
+    liberror_is_null(reaper_collect, reaper);
+    liberror_is_null(reaper_collect, row);
+    liberror_is_null(reaper_collect, status);
+    liberror_is_null(reaper_collect, usage);
+
+    /* Signals are only a hint that something exited, and several of them
+     * can be merged into one, so they are thrown away and every child
+     * that has exited is reaped until there are none left. */
+    while(read(reaper->descriptor, signals, sizeof(signals)) > 0);
+
+    while((pid = (int) wait4(-1, status, WNOHANG, usage)) != 0) {
+        if(pid == -1 && errno == EINTR)
+            continue;
+
+        if(pid == -1 && errno == ECHILD)
+            return 0;
+
+        if(pid == -1)
+            liberror_failure(reaper_collect, wait4);
+
+        child.pid = pid;
+        chashmap_find(reaper->children, child, location, REAPER_CHILD);
+
+        if(location == CHASHMAP_NOT_FOUND)
+            continue;
+
+        *row = reaper->children->contents[location].row;
+        chashmap_remove(reaper->children, child, REAPER_CHILD);
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * This file contains the testcase table, which is what the scheduler
+ * works from. The table keeps each field of a concrete testcase in an
+ * array of its own, so going over every testcase to pick the next one
+ * to run only touches the few fields that picking needs.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "jobs.h"
+#include "../catalyst.h"
+#include "../common/common.h"
+#include "../parsers/parsers.h"
+#include "../testing/testing.h"
+
+/*
+ * Testcases are ranked by a copy of their cost, so that sorting does
+ * not have to reach back into the table.
+*/
+struct TestcaseRank {
+    long cost;
+    int row;
+};
+
+static int compare_ranks(const void *a, const void *b) {
+    const struct TestcaseRank *rank_a = a;
+    const struct TestcaseRank *rank_b = b;
+
+    /* The most costly testcases go first, and ties keep the order of
+     * the configuration. */
+    if(rank_a->cost != rank_b->cost)
+        return rank_a->cost < rank_b->cost ? 1 : -1;
+
+    return rank_a->row - rank_b->row;
+}
+
+static long testcase_cost(struct Testcase testcase) {
+    long cost = TESTCASE_DEFAULT_COST;
+
+    if(testcase.timeout != 0)
+        cost = testcase.timeout;
+
+    return cost + (testcase.input.length + testcase.output.length) / TESTCASE_COST_BYTES;
+}
+
+/*
+ * Rows that want their stdin as a file share one sealed file for each
+ * distinct stdin, which is written once here, rather than once by every
+ * runner. A row that cannot have one is given a pipe.
+*/
+static int input_file(struct TestcaseTable table, struct Testcase testcase) {
+    int location = 0;
+    struct InputFile file;
+
+    if(testcase.stdin_file == 0 || testcase.input.contents == NULL)
+        return -1;
+
+    file.contents = testcase.input.contents;
+    file.length = testcase.input.length;
+    chashmap_find(table.input_files, file, location, INPUT_FILE);
+
+    if(location != CHASHMAP_NOT_FOUND)
+        return table.input_files->contents[location].descriptor;
+
+    if((file.descriptor = sealed_file(file.contents, file.length)) == -1)
+        return -1;
+
+    chashmap_insert(table.input_files, file, INPUT_FILE);
+
+    return file.descriptor;
+}
+
+/*
+ * Rows of a test with a forkserver share it with every other row of that
+ * test, and it is started the first time a row asks for it. A test whose
+ * forkserver could not be started is executed for each of its rows.
+*/
+static int forkserver(struct TestcaseTable table, struct Testcase testcase) {
+    int location = 0;
+    struct Forkserver server;
+
+    if(testcase.forkserver == 0)
+        return -1;
+
+    server.path = testcase.path.contents;
+    server.length = testcase.path.length;
+    chashmap_find(table.forkserver_tests, server, location, FORKSERVER);
+
+    if(location != CHASHMAP_NOT_FOUND)
+        return table.forkserver_tests->contents[location].descriptor;
+
+    server.descriptor = forkserver_start(server.path, &server.pid);
+    chashmap_insert(table.forkserver_tests, server, FORKSERVER);
+
+    return server.descriptor;
+}
+
+static void *table_column(int length, size_t size) {
+    void *column = malloc(length * size + 1);
+
+    if(column == NULL)
+        liberror_failure(testcase_table_init, malloc);
+
+    return column;
+}
+
+struct TestcaseTable testcase_table_init(struct Configuration configuration) {
+    int row = 0;
+    int index = 0;
+    struct TestcaseTable table;
+    struct TestcaseRank *ranks = NULL;
+
+    INIT_VARIABLE(table);
+
+    for(index = 0; index < carray_length(configuration.testcases); index++) {
+        table.length += testcase_variants(configuration.testcases->contents[index]);
+    }
+
+    table.ids = table_column(table.length, sizeof(*table.ids));
+    table.variants = table_column(table.length, sizeof(*table.variants));
+    table.timeouts = table_column(table.length, sizeof(*table.timeouts));
+    table.cpus = table_column(table.length, sizeof(*table.cpus));
+    table.states = table_column(table.length, sizeof(*table.states));
+    table.costs = table_column(table.length, sizeof(*table.costs));
+    table.order = table_column(table.length, sizeof(*table.order));
+    table.pids = table_column(table.length, sizeof(*table.pids));
+    table.deadlines = table_column(table.length, sizeof(*table.deadlines));
+    table.responses = table_column(table.length, sizeof(*table.responses));
+    table.statuses = table_column(table.length, sizeof(*table.statuses));
+    table.usages = table_column(table.length, sizeof(*table.usages));
+    table.inputs = table_column(table.length, sizeof(*table.inputs));
+    table.input_files = chashmap_init(table.input_files, INPUT_FILE);
+    table.forkservers = table_column(table.length, sizeof(*table.forkservers));
+    table.forkserver_tests = chashmap_init(table.forkserver_tests, FORKSERVER);
+    ranks = table_column(table.length, sizeof(*ranks));
+
+    /* Each combination of a matrix testcase is a row of its own, and
+     * is costed with the input and output it will actually be given. */
+    for(index = 0; index < carray_length(configuration.testcases); index++) {
+        int variant = 0;
+        struct Testcase testcase = configuration.testcases->contents[index];
+
+        for(variant = 0; variant < testcase_variants(testcase); variant++, row++) {
+            struct Testcase concrete = testcase_variant(testcase, variant);
+
+            table.ids[row] = index;
+            table.variants[row] = variant;
+            table.timeouts[row] = testcase.timeout;
+            table.cpus[row] = testcase.cpus;
+            table.states[row] = TESTCASE_PENDING;
+            table.pids[row] = 0;
+            libproc_timer_init(table.deadlines + row);
+            table.costs[row] = testcase_cost(concrete);
+            table.inputs[row] = input_file(table, concrete);
+            table.forkservers[row] = forkserver(table, concrete);
+
+            ranks[row].cost = table.costs[row];
+            ranks[row].row = row;
+        }
+    }
+
+    memset(table.responses, 0, table.length * sizeof(*table.responses));
+    memset(table.statuses, 0, table.length * sizeof(*table.statuses));
+    memset(table.usages, 0, table.length * sizeof(*table.usages));
+
+    /* Starting the longest testcases first keeps a long one from being
+     * the only thing left running at the end. */
+    qsort(ranks, table.length, sizeof(*ranks), compare_ranks);
+
+    for(row = 0; row < table.length; row++) {
+        table.order[row] = ranks[row].row;
+    }
+
+    free(ranks);
+
+    return table;
+}
+
+void testcase_table_free(struct TestcaseTable table) {
+    int row = 0;
+
+    for(row = 0; row < table.length; row++) {
+        if(table.responses[row].contents != NULL)
+            cstring_free(table.responses[row]);
+    }
+
+    free(table.ids);
+    free(table.variants);
+    free(table.timeouts);
+    free(table.cpus);
+    free(table.states);
+    free(table.costs);
+    free(table.order);
+    free(table.pids);
+    free(table.deadlines);
+    free(table.responses);
+    free(table.statuses);
+    free(table.usages);
+    free(table.inputs);
+    chashmap_free(table.input_files, INPUT_FILE);
+    free(table.forkservers);
+    chashmap_free(table.forkserver_tests, FORKSERVER);
+}
+
+void testcase_table_stop(struct TestcaseTable table) {
+    int index = 0;
+
+    for(index = 0; index < table.forkserver_tests->capacity; index++) {
+        if(table.forkserver_tests->states[index] != CHASHMAP_FULL)
+            continue;
+
+        forkserver_stop(table.forkserver_tests->contents[index]);
+    }
+}
+
+struct Testcase testcase_table_testcase(struct TestcaseTable table,
+                                        struct Configuration configuration, int row) {
+    struct Testcase testcase = configuration.testcases->contents[table.ids[row]];
+    struct Testcase concrete = testcase_variant(testcase, table.variants[row]);
+
+    if(testcase_variants(testcase) > 1)
+        concrete.name = testcase_variant_name(testcase, table.variants[row]);
+
+    return concrete;
+}
+
+void testcase_table_release(struct TestcaseTable table, struct Configuration configuration,
+                            int row, struct Testcase testcase) {
+    if(testcase_variants(configuration.testcases->contents[table.ids[row]]) > 1)
+        cstring_free(testcase.name);
+}
@@ -46,19 +46,29 @@
 
 int libmatch_cond_before(struct LibmatchCursor *cursor, int ch,
                          const char *characters) {
-    int index = cursor->cursor;
+    int index = 0;
+    struct LibmatchSet set;
 
-    while(index < cursor->length) {
-        int cursor_char = cursor->buffer[index];
+    libmatch_set_init(&set, characters);
+    libmatch_set_add(&set, '\0');
+    libmatch_set_add(&set, ch);
 
-        if(cursor_char == ch)
-            return 1;
+    /* The index is kept relative to the cursor, since a streaming
+     * cursor can move its window while it reads ahead. */
+    while(1) {
+        int position = cursor->cursor + index;
 
-        if(strchr(characters, cursor_char) != NULL)
-            return 0;
+        if(position == cursor->length) {
+            if(libmatch_cursor_read_more(cursor) == 0)
+                return 0;
 
-        index++;
-    }
+            continue;
+        }
+
+        index += libmatch_scan(cursor->buffer + position, cursor->length - position, &set);
+        position = cursor->cursor + index;
 
-    return 0;
+        if(position < cursor->length)
+            return cursor->buffer[position] == (char) ch;
+    }
 }
@@ -39,7 +39,12 @@
  * Cursor-related functions.
 */
 
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "libmatch.h"
 
@@ -79,25 +84,88 @@ struct LibmatchCursor libmatch_cursor_from_stream(FILE *stream) {
     return new_cursor;
 }
 
-int libmatch_cursor_getch(struct LibmatchCursor *cursor) {
-    int character = -1;
+struct LibmatchCursor libmatch_cursor_from_descriptor(int descriptor, int window) {
+    struct LibmatchCursor new_cursor = {LIBMATCH_CURSOR_NULL};
 
-    /* Return EOF */
-    if(cursor->cursor == cursor->length)
-        return LIBMATCH_EOF;
+    if(window < LIBMATCH_MINIMUM_WINDOW)
+        window = LIBMATCH_MINIMUM_WINDOW;
+
+    new_cursor.descriptor = descriptor;
+    new_cursor.capacity = window;
+    new_cursor.buffer = malloc(sizeof(char) * window);
+
+    return new_cursor;
+}
+
+/*
+ * Drop what the cursor can no longer be pushed back to from the
+ * start of the window, keeping count of the lines in it.
+*/
+static void drop_window(struct LibmatchCursor *cursor) {
+    int index = 0;
+    int dropped = cursor->cursor - LIBMATCH_PUSHBACK;
+
+    if(dropped <= 0)
+        return;
 
-    character = cursor->buffer[cursor->cursor];
-    cursor->cursor++;
+    cursor->dropped_lines += libmatch_count_lines(cursor->buffer, dropped);
 
-    /* Handle coordinates */
-    if(character == '\n') {
-        cursor->line++;
-        cursor->character = 0;
+    for(index = dropped - 1; index >= 0; index--) {
+        if(cursor->buffer[index] != '\n')
+            continue;
+
+        cursor->line_start = cursor->offset + index + 1;
+
+        break;
     }
 
-    cursor->character++;
+    memmove(cursor->buffer, cursor->buffer + dropped, cursor->length - dropped);
+    cursor->offset += dropped;
+    cursor->length -= dropped;
+    cursor->cursor -= dropped;
+}
+
+int libmatch_cursor_read_more(struct LibmatchCursor *cursor) {
+    long bytes = 0;
+
+    if(cursor->capacity == 0)
+        return 0;
+
+    drop_window(cursor);
+    libmatch_cursor_free_lines(cursor);
+
+    /* Looking ahead can need more than the window holds */
+    if(cursor->length == cursor->capacity) {
+        cursor->capacity *= 2;
+        cursor->buffer = realloc(cursor->buffer, sizeof(char) * cursor->capacity);
+    }
+
+    do {
+        bytes = (long) read(cursor->descriptor, cursor->buffer + cursor->length,
+                            (size_t) (cursor->capacity - cursor->length));
+    } while(bytes == -1 && errno == EINTR);
+
+    if(bytes <= 0)
+        return 0;
+
+    cursor->length += (int) bytes;
+
+    return (int) bytes;
+}
+
+int libmatch_cursor_fill(struct LibmatchCursor *cursor) {
+    if(cursor->cursor == cursor->length)
+        libmatch_cursor_read_more(cursor);
 
-    return character;
+    return cursor->length - cursor->cursor;
+}
+
+int libmatch_cursor_getch(struct LibmatchCursor *cursor) {
+    /* Return EOF */
+    if(libmatch_cursor_fill(cursor) == 0)
+        return LIBMATCH_EOF;
+
+    return (unsigned char) cursor->buffer[cursor->cursor++];
 }
 
 void libmatch_cursor_ungetch(struct LibmatchCursor *cursor) {
@@ -105,41 +173,78 @@ void libmatch_cursor_ungetch(struct LibmatchCursor *cursor) {
         return;
 
     cursor->cursor--;
+}
 
-    /* Decrement line and character */
-    if(cursor->buffer[cursor->cursor] == '\n') {
-        int index = cursor->cursor - 1;
-        int length = 0;
+int libmatch_cursor_unwind(struct LibmatchCursor *cursor, int distance) {
+    if(distance > cursor->cursor)
+        distance = cursor->cursor;
 
-        cursor->line--;
+    if(distance < 0)
+        distance = 0;
 
-        /* Determine the length of this line */
-        while(index >= 0) {
-            if(cursor->buffer[index] == '\n') {
-                cursor->character = length;
+    cursor->cursor -= distance;
 
-                break;
-            }
-            
-            index--; 
-            length++;
-        }
+    return distance;
+}
 
-        return;
-    }
+/*
+ * Build the index of the new lines in the buffer.
+*/
+static void index_lines(struct LibmatchCursor *cursor) {
+    int index = 0;
+    int offset = 0;
+    struct LibmatchSet newline;
+
+    libmatch_set_init(&newline, "\n");
 
-    cursor->character--;
+    cursor->lines_length = libmatch_count_lines(cursor->buffer, cursor->length);
+    cursor->lines = malloc(sizeof(int) * (cursor->lines_length + 1));
+
+    for(index = 0; index < cursor->lines_length; index++) {
+        offset += libmatch_scan(cursor->buffer + offset, cursor->length - offset, &newline);
+        cursor->lines[index] = offset;
+        offset++;
+    }
 }
 
-int libmatch_cursor_unwind(struct LibmatchCursor *cursor, int distance) {
-    int unwound = 0;
+int libmatch_cursor_line(struct LibmatchCursor *cursor) {
+    int low = 0;
+    int high = 0;
+
+    if(cursor->lines == NULL)
+        index_lines(cursor);
 
-    while((cursor->cursor > 0) && (unwound < distance)) {
-        libmatch_cursor_ungetch(cursor);
-        unwound++;
+    /* The line is the number of new lines before the cursor */
+    high = cursor->lines_length;
+
+    while(low < high) {
+        int middle = low + (high - low) / 2;
+
+        if(cursor->lines[middle] < cursor->cursor) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
     }
 
-    return unwound;
+    return cursor->dropped_lines + low;
+}
+
+int libmatch_cursor_column(struct LibmatchCursor *cursor) {
+    int line = libmatch_cursor_line(cursor) - cursor->dropped_lines;
+
+    /* The line might have started before the window */
+    if(line == 0)
+        return (int) (cursor->offset + cursor->cursor - cursor->line_start) + 1;
+
+    return cursor->cursor - cursor->lines[line - 1];
+}
+
+void libmatch_cursor_free_lines(struct LibmatchCursor *cursor) {
+    free(cursor->lines);
+
+    cursor->lines = NULL;
+    cursor->lines_length = 0;
 }
 
 void libmatch_cursor_enable_pushback(struct LibmatchCursor *cursor) {
@@ -152,4 +257,5 @@ void libmatch_cursor_disable_pushback(struct LibmatchCursor *cursor) {
 
 void libmatch_cursor_free(struct LibmatchCursor *cursor) {
     free(cursor->buffer);
+    libmatch_cursor_free_lines(cursor);
 }
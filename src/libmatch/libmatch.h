@@ -40,12 +40,17 @@
 
 #include <stdio.h>
 
-#define LIBMATCH_CURSOR_NULL 0, 0, NULL, 0, 0, 0
+#define LIBMATCH_CURSOR_NULL 0, 0, NULL, NULL, 0, 0, 0, 0, 0L, 0, 0L
 #define LIBMATCH_EOF         -1
 
 #define LIBMATCH_INITIAL_BUFFER_SIZE    1024
 #define LIBMATCH_BUFFER_GROWTH          512
 
+/* Characters before the cursor that a streaming cursor keeps when it
+ * refills its window, which bounds how far it can be pushed back */
+#define LIBMATCH_PUSHBACK               256
+#define LIBMATCH_MINIMUM_WINDOW         (LIBMATCH_PUSHBACK * 4)
+
 /* Character classes */
 #define LIBMATCH_LOWER      "abcdefghijklmnopqrstuvwxyz"
 #define LIBMATCH_UPPER      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -60,6 +65,12 @@
 #define LIBMATCH_PRINTABLE      \
     "QWERTYUIOPASDFGHJKLZXCVBNMqwertyuiopasdfghjklzxcvbnm[];',./{}:\"<>?1234567890!@#$%^&*()-=_+`~\\|"
 
+/* Sets with at most this many members can be scanned for with SIMD */
+#define LIBMATCH_SET_SMALL  4
+
+#define LIBMATCH_SET_HAS(set, character) \
+    (((set)->bits[(unsigned char) (character) >> 3] >> ((unsigned char) (character) & 7)) & 1)
+
 #define _libmatch_pushback(cursor)          \
     if(cursor->pushback == 1) {             \
         libmatch_cursor_ungetch(cursor);    \
@@ -67,19 +78,48 @@
 
 /*
  * A 'cursor' used to tell where the matching process is in a
- * stream.
+ * stream. The position of the cursor is only an offset. Lines and
+ * columns are only needed for error reporting, so they are worked
+ * out from an index of the new lines in the buffer, which is built
+ * the first time one is asked for.
+ *
+ * A streaming cursor reads from a file descriptor, and its buffer
+ * is only a window into the file. When the cursor reaches the end of
+ * the window, everything but the last LIBMATCH_PUSHBACK characters
+ * before the cursor is dropped, and the window is refilled. Offsets
+ * are relative to the window, so a position is only good until the
+ * next refill.
 */
 struct LibmatchCursor {
     int length;
     int cursor;
     char *buffer;
 
-    /* Coordinates-- useful for error reporting */
-    int line;
-    int character;
+    /* Offsets of the new lines in the buffer, or NULL */
+    int *lines;
+    int lines_length;
 
     /* Settings */
     int pushback;
+
+    /* Streaming. The capacity of the window is zero for a cursor
+     * that has all of its input in its buffer. */
+    int descriptor;
+    int capacity;
+    long offset;
+    int dropped_lines;
+    long line_start;
+};
+
+/*
+ * A set of characters, as a bitmap with a bit for each byte. A set
+ * with only a few members also lists them, so that they can be
+ * scanned for with SIMD instructions.
+*/
+struct LibmatchSet {
+    int count;
+    char members[LIBMATCH_SET_SMALL];
+    unsigned char bits[256 / 8];
 };
 
 /*
@@ -101,10 +141,43 @@ struct LibmatchCursor libmatch_cursor_init(char *buffer, int length);
 */
 struct LibmatchCursor libmatch_cursor_from_stream(FILE *stream);
 
+/*
+ * Initialize a new streaming cursor that reads from a file
+ * descriptor through a window of a fixed size. The window may grow
+ * past that size only when a function has to look ahead further than
+ * it, like libmatch_cond_before. The descriptor is not closed by
+ * libmatch_cursor_free.
+ *
+ * @param descriptor: the file descriptor to read from
+ * @param window: the size of the window, at least LIBMATCH_MINIMUM_WINDOW
+ * @return: a new cursor
+*/
+struct LibmatchCursor libmatch_cursor_from_descriptor(int descriptor, int window);
+
+/*
+ * Returns the number of characters after the cursor in its buffer.
+ * If there are none, a streaming cursor refills its window first.
+ *
+ * @param cursor: the cursor to use
+ * @return: the number of characters available, or 0 at the end
+*/
+int libmatch_cursor_fill(struct LibmatchCursor *cursor);
+
+/*
+ * Reads more of the input of a streaming cursor into its window,
+ * keeping everything after the cursor. Cursors that have all of
+ * their input do nothing.
+ *
+ * @param cursor: the cursor to use
+ * @return: the number of characters read, or 0 at the end
+*/
+int libmatch_cursor_read_more(struct LibmatchCursor *cursor);
+
 /*
  * Returns the next character in the buffer, and advances the
  * cursor. If the end of the buffer is reached, LIBMATCH_EOF is
  * returned from this function, and the cursor is not advanced.
+ * Characters are returned as unsigned chars.
  *
  * @param cursor: the cursor to use
  * @return: the next character
@@ -128,7 +201,9 @@ void libmatch_cursor_disable_pushback(struct LibmatchCursor *cursor);
 /*
  * Pushes the cursor back by one character. If the cursor is
  * at the start of the buffer, then the cursor is not advanced
- * backwards.
+ * backwards. A streaming cursor can always be pushed back to
+ * LIBMATCH_PUSHBACK characters before the furthest point it has
+ * read to.
  *
  * @param cursor: the cursor to use
 */
@@ -152,6 +227,37 @@ int libmatch_cursor_unwind(struct LibmatchCursor *cursor, int distance);
 */
 void libmatch_cursor_free(struct LibmatchCursor *cursor);
 
+/*
+ * Returns the line that the cursor is on, starting from zero. The
+ * first time this is called, the cursor builds an index of the new
+ * lines in its buffer, so the buffer must not change afterwards.
+ * A streaming cursor counts the lines it drops from its window, and
+ * builds the index again after each refill.
+ *
+ * @param cursor: the cursor to use
+ * @return: the line of the cursor
+*/
+int libmatch_cursor_line(struct LibmatchCursor *cursor);
+
+/*
+ * Returns the column of the character under the cursor, starting
+ * from one. Like libmatch_cursor_line, this builds the new line
+ * index the first time.
+ *
+ * @param cursor: the cursor to use
+ * @return: the column of the cursor
+*/
+int libmatch_cursor_column(struct LibmatchCursor *cursor);
+
+/*
+ * Releases the new line index of a cursor, if it has one. This is
+ * for cursors whose buffers are not released with
+ * libmatch_cursor_free.
+ *
+ * @param cursor: the cursor to release the index of
+*/
+void libmatch_cursor_free_lines(struct LibmatchCursor *cursor);
+
 /*
  * Assert that the exact next n characters are in a set of
  * characters. Once the correct number of characters are
@@ -330,4 +436,63 @@ char *libmatch_read_alloc_until(struct LibmatchCursor *cursor,
 int libmatch_cond_before(struct LibmatchCursor *cursor, int ch,
                          const char *characters);
 
+/*
+ * Initializes a set of characters from a string of its members. The
+ * NUL byte is not a member unless it is added.
+ *
+ * @param set: the set to initialize
+ * @param characters: the members of the set
+*/
+void libmatch_set_init(struct LibmatchSet *set, const char *characters);
+
+/*
+ * Adds a character to a set of characters.
+ *
+ * @param set: the set to add to
+ * @param character: the character to add
+*/
+void libmatch_set_add(struct LibmatchSet *set, int character);
+
+/*
+ * Finds the first character in a buffer that is in a set. Small sets
+ * are scanned for many bytes at a time with SSE2 or AVX2 when they are
+ * available.
+ *
+ * @param buffer: the buffer to scan
+ * @param length: the length of the buffer
+ * @param set: the characters to stop at
+ * @return: the index of the character, or the length if there is none
+*/
+int libmatch_scan(const char *buffer, int length, const struct LibmatchSet *set);
+
+/*
+ * Finds the first character in a buffer that is not in a set.
+ *
+ * @param buffer: the buffer to scan
+ * @param length: the length of the buffer
+ * @param set: the characters to skip
+ * @return: the index of the character, or the length if there is none
+*/
+int libmatch_span(const char *buffer, int length, const struct LibmatchSet *set);
+
+/*
+ * Counts the new lines in a buffer, many bytes at a time when SSE2
+ * or AVX2 is available.
+ *
+ * @param buffer: the buffer to count in
+ * @param length: the length of the buffer
+ * @return: the number of new lines
+*/
+int libmatch_count_lines(const char *buffer, int length);
+
+/*
+ * Advances the cursor by a number of characters at once. The cursor
+ * is not advanced past the end of the buffer, or the window of a
+ * streaming cursor.
+ *
+ * @param cursor: the cursor to advance
+ * @param distance: the number of characters to advance by
+*/
+void libmatch_cursor_advance(struct LibmatchCursor *cursor, int distance);
+
 #endif
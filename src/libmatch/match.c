@@ -46,41 +46,68 @@
 
 int libmatch_expect(struct LibmatchCursor *cursor, int count,
                     const char *characters) {
-    int character = -1;
     int matched = 0;
+    struct LibmatchSet set;
 
-    while((character = libmatch_cursor_getch(cursor)) != LIBMATCH_EOF) {
-        if(strchr(characters, character) == NULL) {
-            _libmatch_pushback(cursor);
+    /* Like strchr, the NUL byte is always one of the characters */
+    libmatch_set_init(&set, characters);
+    libmatch_set_add(&set, '\0');
+
+    while(count <= 0 || matched < count) {
+        int span = 0;
+        int available = libmatch_cursor_fill(cursor);
 
+        if(available == 0)
             break;
-        }
 
-        matched++;
+        if(count > 0 && count - matched < available)
+            available = count - matched;
+
+        span = libmatch_span(cursor->buffer + cursor->cursor, available, &set);
+        libmatch_cursor_advance(cursor, span);
+        matched += span;
 
-        if(matched == count)
-            return 1;
+        if(span < available)
+            break;
     }
 
+    if(count > 0 && matched == count)
+        return 1;
+
+    /* The character that did not match is consumed, unless it is
+     * pushed back. */
+    if(cursor->pushback == 0)
+        libmatch_cursor_getch(cursor);
+
     return 0;
 }
 
 int libmatch_atleast(struct LibmatchCursor *cursor, int count,
                      const char *characters) {
-    int character = -1;
     int matched = 0;
+    struct LibmatchSet set;
 
-    while((character = libmatch_cursor_getch(cursor)) != LIBMATCH_EOF) {
-        if(strchr(characters, character) == NULL) {
-            _libmatch_pushback(cursor);
+    libmatch_set_init(&set, characters);
+    libmatch_set_add(&set, '\0');
+
+    while(1) {
+        int span = 0;
+        int available = libmatch_cursor_fill(cursor);
 
+        if(available == 0)
             break;
-        }
 
-        matched++;
+        span = libmatch_span(cursor->buffer + cursor->cursor, available, &set);
+        libmatch_cursor_advance(cursor, span);
+        matched += span;
 
+        if(span < available)
+            break;
     }
 
+    if(cursor->pushback == 0)
+        libmatch_cursor_getch(cursor);
+
     if(matched >= count)
         return 1;
 
@@ -113,19 +140,20 @@ int libmatch_strings_expect(struct LibmatchCursor *cursor, ...) {
     va_list strings;
     const char *string = NULL;
     int index = 0;
-    int cursor_position = cursor->cursor;
-    int cursor_line = cursor->line;
-    int cursor_character = cursor->character;
+    long cursor_position = cursor->offset + cursor->cursor;
 
     va_start(strings, cursor);
 
     while((string = va_arg(strings, char *)) != NULL) {
 
-        /* Reset cursor */
+        /* Reset cursor. A streaming cursor may have moved its window
+         * since, so the position is kept relative to the input. */
         if(libmatch_string_expect(cursor, string) == 0) {
-            cursor->cursor = cursor_position;
-            cursor->line = cursor_line;
-            cursor->character = cursor_character;
+            cursor->cursor = (int) (cursor_position - cursor->offset);
+
+            if(cursor->cursor < 0)
+                cursor->cursor = 0;
+
             index++;
 
             continue;
@@ -139,19 +167,29 @@ int libmatch_strings_expect(struct LibmatchCursor *cursor, ...) {
 
 int libmatch_until(struct LibmatchCursor *cursor, const char *characters) {
     int matched = 0;
-    int character = -1;
+    struct LibmatchSet set;
 
-    while((character = libmatch_cursor_getch(cursor)) != LIBMATCH_EOF) {
-        if(strchr(characters, character) != NULL) {
-            _libmatch_pushback(cursor);
+    libmatch_set_init(&set, characters);
+    libmatch_set_add(&set, '\0');
+
+    while(1) {
+        int span = 0;
+        int available = libmatch_cursor_fill(cursor);
 
+        if(available == 0)
             break;
-        }
 
+        span = libmatch_scan(cursor->buffer + cursor->cursor, available, &set);
+        libmatch_cursor_advance(cursor, span);
+        matched += span;
 
-        matched++;
+        if(span < available)
+            break;
     }
 
+    if(cursor->pushback == 0)
+        libmatch_cursor_getch(cursor);
+
     return matched;
 }
 
@@ -173,20 +211,26 @@ int libmatch_expect_next(struct LibmatchCursor *cursor,
 
 int libmatch_next_line(struct LibmatchCursor *cursor) {
     int skipped = 0;
-    int character = -1;
+    struct LibmatchSet set;
 
-    if(cursor->buffer[cursor->cursor] == '\n') {
-        libmatch_cursor_getch(cursor);
+    libmatch_set_init(&set, "\n");
 
-        return 0;
-    }
+    while(1) {
+        int span = 0;
+        int available = libmatch_cursor_fill(cursor);
 
-    while((character = libmatch_cursor_getch(cursor)) != LIBMATCH_EOF) {
-        if(character == '\n')
+        if(available == 0)
             break;
 
-        skipped++;
+        span = libmatch_scan(cursor->buffer + cursor->cursor, available, &set);
+        libmatch_cursor_advance(cursor, span);
+        skipped += span;
+
+        if(span < available)
+            break;
     }
 
+    libmatch_cursor_getch(cursor);
+
     return skipped;
 }
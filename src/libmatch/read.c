@@ -157,19 +157,19 @@ char *libmatch_read_alloc_literal(struct LibmatchCursor *cursor) {
 
 int libmatch_read_n(struct LibmatchCursor *cursor, char *buffer, int count) {
     int written = 0;
-    int character = -1;
-    int buffer_cursor = 0;
-
-    if(count == 0)
-        return 0;
 
-    while((character = libmatch_cursor_getch(cursor)) != EOF) {
-        buffer[buffer_cursor] = character;
-        buffer_cursor++;
-        written++;
+    while(written < count) {
+        int available = libmatch_cursor_fill(cursor);
 
-        if(written == count)
+        if(available == 0)
             break;
+
+        if(count - written < available)
+            available = count - written;
+
+        memcpy(buffer + written, cursor->buffer + cursor->cursor, available);
+        libmatch_cursor_advance(cursor, available);
+        written += available;
     }
 
     buffer[written] = '\0';
@@ -180,25 +180,37 @@ int libmatch_read_n(struct LibmatchCursor *cursor, char *buffer, int count) {
 int libmatch_read_until(struct LibmatchCursor *cursor, char *buffer,
                         int length, const char *characters) {
     int written = 0;
-    int character = -1;
-    int buffer_cursor = 0;
+    int stopped = 0;
+    struct LibmatchSet set;
 
-    while((character = libmatch_cursor_getch(cursor)) != EOF) {
-        if(strchr(characters, character) != NULL) {
-            _libmatch_pushback(cursor);
+    libmatch_set_init(&set, characters);
+    libmatch_set_add(&set, '\0');
+
+    while(written < length) {
+        int span = 0;
+        int available = libmatch_cursor_fill(cursor);
 
+        if(available == 0)
             break;
-        }
 
-        buffer[buffer_cursor] = character;
-        buffer_cursor++;
-        written++;
+        if(length - written < available)
+            available = length - written;
 
-        if(written == length)
+        span = libmatch_scan(cursor->buffer + cursor->cursor, available, &set);
+        memcpy(buffer + written, cursor->buffer + cursor->cursor, span);
+        libmatch_cursor_advance(cursor, span);
+        written += span;
+
+        if((stopped = span < available) == 1)
             break;
     }
 
-    buffer[buffer_cursor] = '\0';
+    /* The character that stopped the read is consumed, unless it is
+     * pushed back. Running out of room does not consume anything. */
+    if(stopped == 1 && cursor->pushback == 0)
+        libmatch_cursor_getch(cursor);
+
+    buffer[written] = '\0';
 
     return written;
 }
@@ -206,29 +218,38 @@ int libmatch_read_until(struct LibmatchCursor *cursor, char *buffer,
 char *libmatch_read_alloc_until(struct LibmatchCursor *cursor,
                                 const char *characters) {
     int written = 0;
-    int character = -1;
-    int buffer_cursor = 0;
     int capacity = LIBMATCH_INITIAL_BUFFER_SIZE;
     char *buffer = malloc(sizeof(char) * (LIBMATCH_INITIAL_BUFFER_SIZE + 1));
+    struct LibmatchSet set;
 
-    while((character = libmatch_cursor_getch(cursor)) != EOF) {
-        if(strchr(characters, character) != NULL) {
-            libmatch_cursor_ungetch(cursor);
+    libmatch_set_init(&set, characters);
+    libmatch_set_add(&set, '\0');
 
+    while(1) {
+        int span = 0;
+        int available = libmatch_cursor_fill(cursor);
+
+        if(available == 0)
             break;
-        }
 
-        buffer[buffer_cursor] = character;
-        buffer_cursor++;
-        written++;
+        span = libmatch_scan(cursor->buffer + cursor->cursor, available, &set);
 
-        if(written == capacity) {
-            capacity += LIBMATCH_BUFFER_GROWTH;
-            buffer = realloc(buffer, sizeof(char) * capacity);
+        if(written + span > capacity) {
+            while(written + span > capacity)
+                capacity *= 2;
+
+            buffer = realloc(buffer, sizeof(char) * (capacity + 1));
         }
+
+        memcpy(buffer + written, cursor->buffer + cursor->cursor, span);
+        libmatch_cursor_advance(cursor, span);
+        written += span;
+
+        if(span < available)
+            break;
     }
 
-    buffer[buffer_cursor] = '\0';
+    buffer[written] = '\0';
 
     return buffer;
 }
@@ -0,0 +1,250 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Functions for scanning through a buffer in bulk, rather than a
+ * character at a time.
+ *
+ * Sets of characters are bitmaps, so testing whether a character is in
+ * a set is a single lookup rather than a call to strchr. A set with only
+ * a few members also keeps a list of them, and is scanned for with SSE2,
+ * or AVX2 when the processor supports it, sixteen or thirty two bytes at
+ * a time. Everywhere else, the bitmap is used one byte at a time.
+*/
+
+#include <string.h>
+
+#include "libmatch.h"
+
+/* Distance to scan one byte at a time before using the vector units */
+#define LIBMATCH_SCAN_SHORT     32
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define LIBMATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(LIBMATCH_SSE2) && (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define LIBMATCH_AVX2
+#include <immintrin.h>
+#endif
+
+void libmatch_set_init(struct LibmatchSet *set, const char *characters) {
+    memset(set, 0, sizeof(*set));
+
+    while(*characters != '\0') {
+        libmatch_set_add(set, *characters);
+        characters++;
+    }
+}
+
+void libmatch_set_add(struct LibmatchSet *set, int character) {
+    unsigned char byte = (unsigned char) character;
+
+    if(LIBMATCH_SET_HAS(set, byte) == 1)
+        return;
+
+    set->bits[byte >> 3] |= (unsigned char) (1 << (byte & 7));
+
+    /* Sets that get too big are only scanned for with the bitmap */
+    if(set->count >= 0 && set->count < LIBMATCH_SET_SMALL) {
+        set->members[set->count] = (char) byte;
+        set->count++;
+    } else {
+        set->count = -1;
+    }
+}
+
+#ifdef LIBMATCH_SSE2
+static int scan_sse2(const char *buffer, int length, const struct LibmatchSet *set) {
+    int index = 0;
+    int member = 0;
+    __m128i members[LIBMATCH_SET_SMALL];
+
+    for(member = 0; member < set->count; member++) {
+        members[member] = _mm_set1_epi8(set->members[member]);
+    }
+
+    for(index = 0; index + 16 <= length; index += 16) {
+        int mask = 0;
+        __m128i block = _mm_loadu_si128((const __m128i *) (buffer + index));
+        __m128i hits = _mm_cmpeq_epi8(block, members[0]);
+
+        for(member = 1; member < set->count; member++) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, members[member]));
+        }
+
+        if((mask = _mm_movemask_epi8(hits)) != 0)
+            return index + __builtin_ctz((unsigned int) mask);
+    }
+
+    return index;
+}
+
+static int count_lines_sse2(const char *buffer, int length, int *counted) {
+    int index = 0;
+    int lines = 0;
+    __m128i newline = _mm_set1_epi8('\n');
+
+    for(index = 0; index + 16 <= length; index += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (buffer + index));
+
+        lines += __builtin_popcount((unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+    }
+
+    *counted = index;
+
+    return lines;
+}
+#endif
+
+#ifdef LIBMATCH_AVX2
+__attribute__((target("avx2")))
+static int scan_avx2(const char *buffer, int length, const struct LibmatchSet *set) {
+    int index = 0;
+    int member = 0;
+    __m256i members[LIBMATCH_SET_SMALL];
+
+    for(member = 0; member < set->count; member++) {
+        members[member] = _mm256_set1_epi8(set->members[member]);
+    }
+
+    for(index = 0; index + 32 <= length; index += 32) {
+        unsigned int mask = 0;
+        __m256i block = _mm256_loadu_si256((const __m256i *) (buffer + index));
+        __m256i hits = _mm256_cmpeq_epi8(block, members[0]);
+
+        for(member = 1; member < set->count; member++) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, members[member]));
+        }
+
+        if((mask = (unsigned int) _mm256_movemask_epi8(hits)) != 0)
+            return index + __builtin_ctz(mask);
+    }
+
+    return index;
+}
+
+__attribute__((target("avx2")))
+static int count_lines_avx2(const char *buffer, int length, int *counted) {
+    int index = 0;
+    int lines = 0;
+    __m256i newline = _mm256_set1_epi8('\n');
+
+    for(index = 0; index + 32 <= length; index += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (buffer + index));
+
+        lines += __builtin_popcount((unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+    }
+
+    *counted = index;
+
+    return lines;
+}
+#endif
+
+int libmatch_scan(const char *buffer, int length, const struct LibmatchSet *set) {
+    int index = 0;
+    int limit = length < LIBMATCH_SCAN_SHORT ? length : LIBMATCH_SCAN_SHORT;
+
+    /* Characters are often close by, and then setting up the vector
+     * units costs more than it saves. */
+    while(index < limit && LIBMATCH_SET_HAS(set, buffer[index]) == 0)
+        index++;
+
+    if(index < limit || index == length)
+        return index;
+
+    /* Let the vector units get as close as they can, and finish off the
+     * rest of the buffer with the bitmap. */
+    if(set->count > 0) {
+#ifdef LIBMATCH_AVX2
+        if(__builtin_cpu_supports("avx2"))
+            index += scan_avx2(buffer + index, length - index, set);
+#endif
+#ifdef LIBMATCH_SSE2
+        index += scan_sse2(buffer + index, length - index, set);
+#endif
+    }
+
+    while(index < length && LIBMATCH_SET_HAS(set, buffer[index]) == 0)
+        index++;
+
+    return index;
+}
+
+int libmatch_span(const char *buffer, int length, const struct LibmatchSet *set) {
+    int index = 0;
+
+    while(index < length && LIBMATCH_SET_HAS(set, buffer[index]) == 1)
+        index++;
+
+    return index;
+}
+
+int libmatch_count_lines(const char *buffer, int length) {
+    int index = 0;
+    int lines = 0;
+
+#ifdef LIBMATCH_AVX2
+    if(__builtin_cpu_supports("avx2"))
+        lines = count_lines_avx2(buffer, length, &index);
+#endif
+#ifdef LIBMATCH_SSE2
+    {
+        int counted = 0;
+
+        lines += count_lines_sse2(buffer + index, length - index, &counted);
+        index += counted;
+    }
+#endif
+
+    for(; index < length; index++) {
+        if(buffer[index] == '\n')
+            lines++;
+    }
+
+    return lines;
+}
+
+void libmatch_cursor_advance(struct LibmatchCursor *cursor, int distance) {
+    if(distance > cursor->length - cursor->cursor)
+        distance = cursor->length - cursor->cursor;
+
+    cursor->cursor += distance;
+}
@@ -50,9 +50,11 @@
         "carray_init: default length must be greater than 0"
 #endif
 
+/* Growth is geometric so that appending n values copies O(n) values
+ * in total. */
 #ifndef CARRAY_RESIZE
 #define CARRAY_RESIZE(size) \
-    ((size) + 5)
+    ((size) < CARRAY_INITIAL_SIZE ? CARRAY_INITIAL_SIZE : (size) * 2)
 #endif
 
 #ifndef CARRAY_COUNTER_TYPE 
@@ -253,6 +255,67 @@ do {                                                                          \
     (array)->contents[(array)->length] = value;                               \
     (array)->length++
 
+#define carray_reserve(array, _capacity, namespace)                           \
+do {                                                                          \
+    __carray_assert_nonnull("carray_reserve", "array", array);                \
+    __carray_assert_nonnull("carray_reserve", "array->contents",              \
+                                             (array)->contents);              \
+                                                                              \
+    if((array)->capacity >= (_capacity))                                      \
+        break;                                                                \
+                                                                              \
+    if(namespace ## _HEAP == 0) {                                             \
+        fprintf(stderr, "carray_reserve: cannot grow array with maximum "     \
+                        "capacity of %i (%s:%i)\n", (array)->capacity,        \
+                        __FILE__, __LINE__);                                  \
+        abort();                                                              \
+    }                                                                         \
+                                                                              \
+    (array)->capacity = (CARRAY_COUNTER_TYPE) (_capacity);                    \
+    (array)->contents = realloc((array)->contents,                            \
+                                sizeof(*(array)->contents)                    \
+                                * (size_t) (array)->capacity);                \
+} while(0)
+
+#define carray_extend(array, values, count, namespace)                        \
+do {                                                                          \
+    CARRAY_COUNTER_TYPE __CARRAY_CAPACITY = 0;                                \
+                                                                              \
+    __carray_assert_nonnull("carray_extend", "array", array);                 \
+    __carray_assert_nonnull("carray_extend", "values", values);               \
+                                                                              \
+    /* Grow geometrically, unless that is still not enough */                 \
+    if((array)->length + (count) > (array)->capacity) {                       \
+        __CARRAY_CAPACITY = (CARRAY_COUNTER_TYPE)                             \
+                            CARRAY_RESIZE((array)->capacity);                 \
+                                                                              \
+        if(__CARRAY_CAPACITY < (array)->length + (count))                     \
+            __CARRAY_CAPACITY = (array)->length + (count);                    \
+                                                                              \
+        carray_reserve(array, __CARRAY_CAPACITY, namespace);                  \
+    }                                                                         \
+                                                                              \
+    memcpy((array)->contents + (array)->length, (values),                     \
+           sizeof(*(array)->contents) * (size_t) (count));                    \
+    (array)->length += (count);                                               \
+} while(0)
+
+#define carray_shrink(array, namespace)                                       \
+do {                                                                          \
+    __carray_assert_nonnull("carray_shrink", "array", array);                 \
+    __carray_assert_nonnull("carray_shrink", "array->contents",               \
+                                            (array)->contents);               \
+                                                                              \
+    if(namespace ## _HEAP == 0 || (array)->length == (array)->capacity ||     \
+       (array)->length == 0)                                                  \
+        break;                                                                \
+                                                                              \
+    (array)->capacity = (array)->length;                                      \
+    (array)->contents = realloc((array)->contents,                            \
+                                sizeof(*(array)->contents)                    \
+                                * (size_t) (array)->capacity);                \
+} while(0)
+
 #define carray_length(array) \
     ((array)->length)
 
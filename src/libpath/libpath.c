@@ -104,6 +104,46 @@ int libpath_rmdir(const char *path) {
     return rmdir(path);
 }
 
+#if defined(__unix__)
+int libpath_rmtree(const char *path) {
+    DIR *directory = NULL;
+    struct dirent *entry = NULL;
+    char node[LIBPATH_MAX_PATH + 1];
+
+    liberror_is_null(libpath_rmtree, path);
+
+    /* Anything but a directory, including a link to one, is unlinked
+     * without looking inside of it. */
+    if(unlink(path) == 0 || errno == ENOENT)
+        return LIBPATH_SUCCESS;
+
+    if((directory = opendir(path)) == NULL)
+        return LIBPATH_FAILURE;
+
+    while((entry = readdir(directory)) != NULL) {
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        if(libpath_join_path(node, LIBPATH_MAX_PATH, path, entry->d_name, NULL) >= LIBPATH_MAX_PATH) {
+            errno = ENAMETOOLONG;
+            closedir(directory);
+
+            return LIBPATH_FAILURE;
+        }
+
+        if(libpath_rmtree(node) == LIBPATH_FAILURE) {
+            closedir(directory);
+
+            return LIBPATH_FAILURE;
+        }
+    }
+
+    closedir(directory);
+
+    return rmdir(path);
+}
+#endif
+
 int libpath_mkdir(const char *path, int mode) {
 #if defined(_MSDOS)
     return mkdir(path);
@@ -358,6 +358,47 @@ int libpath_mkdir(const char *path, int mode);
 */
 int libpath_rmdir(const char *path);
 
+/*
+ * @docgen: function
+ * @brief: remove a directory and everything in it
+ * @name: libpath_rmtree
+ *
+ * @include: libpath.h
+ *
+ * @description
+ * @Removes the file or directory at the path specified, and if it is a
+ * @directory, everything inside of it. Symbolic links are removed, not
+ * @followed. Removal stops at the first node that cannot be removed.
+ * @description
+ *
+ * @example
+ * @#include <stdio.h>
+ * @#include <errno.h>
+ * @#include <stdlib.h>
+ * @#include <string.h>
+ * @
+ * @#include "libpath.h"
+ * @
+ * @int main(void) {
+ * @    if(libpath_rmtree("build") == LIBPATH_FAILURE) {
+ * @        fprintf(stderr, "prog: failed to remove build (%s)\n", strerror(errno));
+ * @        exit(EXIT_FAILURE);
+ * @    }
+ * @
+ * @    return 0;
+ * @}
+ * @example
+ *
+ * @error: path is NULL
+ *
+ * @param path: the path of the tree to remove
+ * @type: const char *
+ *
+ * @return: LIBPATH_SUCCESS on success, and LIBPATH_FAILURE on failure
+ * @type: int
+*/
+int libpath_rmtree(const char *path);
+
 /*
  * Determines whether or not the path provided exists or not.
  *
@@ -44,6 +44,17 @@
  * @embed constant: LIBPROC_SLEEP_MILLI
  * @embed constant: LIBPROC_SLEEP_SECOND
  * @embed function: libproc_sleep
+ * @embed constant: LIBPROC_WHEEL_BITS
+ * @embed constant: LIBPROC_WHEEL_SLOTS
+ * @embed constant: LIBPROC_WHEEL_LEVELS
+ * @embed structure: LibprocTimer
+ * @embed structure: LibprocTimers
+ * @embed function: libproc_timers_init
+ * @embed function: libproc_timer_init
+ * @embed function: libproc_timer_start
+ * @embed function: libproc_timer_cancel
+ * @embed function: libproc_timers_next
+ * @embed function: libproc_timers_expire
  *
  * @description
  * @libproc is a library that aims to allow cross platform handling of
@@ -54,6 +65,12 @@
  * @sep: ;
  * @Manual;Description
  * @libproc_sleep(cware);microsecond sleeping
+ * @libproc_timers_init(cware);prepare a timer wheel
+ * @libproc_timer_init(cware);prepare a timer
+ * @libproc_timer_start(cware);start a timer
+ * @libproc_timer_cancel(cware);cancel a timer
+ * @libproc_timers_next(cware);time until the next timer expires
+ * @libproc_timers_expire(cware);collect the timers that have expired
  * @table
  * @description
  *
@@ -140,6 +157,234 @@
 */
 void libproc_sleep(int microseconds);
 
+/*
+ * Timers are kept in a hierarchical timing wheel with a resolution of one
+ * millisecond. Each level of the wheel has LIBPROC_WHEEL_SLOTS slots, and
+ * each slot of a level spans as much time as a whole turn of the level
+ * below it, so starting and cancelling a timer takes constant time no
+ * matter how many there are. Timers that are further away than the whole
+ * wheel are kept in its last slot, and put back in when it comes around.
+*/
+
+/*
+ * @docgen: constant
+ * @name: LIBPROC_WHEEL_BITS
+ * @brief: the number of bits of time each level of a wheel covers
+ * @value: 6
+*/
+#define LIBPROC_WHEEL_BITS      6
+
+/*
+ * @docgen: constant
+ * @name: LIBPROC_WHEEL_SLOTS
+ * @brief: the number of slots in each level of a wheel
+ * @value: 64
+*/
+#define LIBPROC_WHEEL_SLOTS     (1 << LIBPROC_WHEEL_BITS)
+
+/*
+ * @docgen: constant
+ * @name: LIBPROC_WHEEL_LEVELS
+ * @brief: the number of levels in a wheel
+ * @value: 4
+*/
+#define LIBPROC_WHEEL_LEVELS    4
+
+/*
+ * @docgen: structure
+ * @brief: a timer in a timer wheel
+ * @name: LibprocTimer
+ *
+ * @description
+ * @A timer is kept in the slot of the wheel that it expires in, linked
+ * @to the other timers in the same slot. Timers belong to the caller,
+ * @so they should not be released while they are started.
+ * @description
+ *
+ * @field expires: the time the timer expires at, in milliseconds
+ * @type: long
+ *
+ * @field level: the level of the wheel the timer is in, or -1
+ * @type: int
+ *
+ * @field slot: the slot of the level the timer is in
+ * @type: int
+ *
+ * @field next: the next timer in the same slot, or expired list
+ * @type: struct LibprocTimer *
+ *
+ * @field previous: the previous timer in the same slot
+ * @type: struct LibprocTimer *
+*/
+struct LibprocTimer {
+    long expires;
+    int level;
+    int slot;
+    struct LibprocTimer *next;
+    struct LibprocTimer *previous;
+};
+
+/*
+ * @docgen: structure
+ * @brief: a hierarchical timing wheel
+ * @name: LibprocTimers
+ *
+ * @field now: the time the wheel has been turned to, in milliseconds
+ * @type: long
+ *
+ * @field origin: the monotonic clock when the wheel was made, in seconds
+ * @type: long
+ *
+ * @field counts: the number of timers in each level
+ * @type: int
+ *
+ * @field slots: the timers in each slot of each level
+ * @type: struct LibprocTimer *
+*/
+struct LibprocTimers {
+    long now;
+    long origin;
+    int counts[LIBPROC_WHEEL_LEVELS];
+    struct LibprocTimer *slots[LIBPROC_WHEEL_LEVELS][LIBPROC_WHEEL_SLOTS];
+};
+
+/*
+ * @docgen: function
+ * @brief: prepare a timer wheel
+ * @name: libproc_timers_init
+ *
+ * #include: libproc.h
+ *
+ * @description
+ * @This function will empty a timer wheel, and start its time at the
+ * @current time of the monotonic clock.
+ * @description
+ *
+ * @error: timers is NULL
+ *
+ * @param timers: the wheel to prepare
+ * @type: struct LibprocTimers *
+*/
+void libproc_timers_init(struct LibprocTimers *timers);
+
+/*
+ * @docgen: function
+ * @brief: prepare a timer
+ * @name: libproc_timer_init
+ *
+ * #include: libproc.h
+ *
+ * @description
+ * @This function will prepare a timer that has not been started, so
+ * @that it can be started or cancelled.
+ * @description
+ *
+ * @error: timer is NULL
+ *
+ * @param timer: the timer to prepare
+ * @type: struct LibprocTimer *
+*/
+void libproc_timer_init(struct LibprocTimer *timer);
+
+/*
+ * @docgen: function
+ * @brief: start a timer
+ * @name: libproc_timer_start
+ *
+ * #include: libproc.h
+ *
+ * @description
+ * @This function will start a timer that expires in a number of
+ * @milliseconds from now. A timer that is already started is restarted.
+ * @description
+ *
+ * @error: timers is NULL
+ * @error: timer is NULL
+ * @error: milliseconds is negative
+ *
+ * @param timers: the wheel to start the timer in
+ * @type: struct LibprocTimers *
+ *
+ * @param timer: the timer to start
+ * @type: struct LibprocTimer *
+ *
+ * @param milliseconds: the number of milliseconds until it expires
+ * @type: long
+*/
+void libproc_timer_start(struct LibprocTimers *timers, struct LibprocTimer *timer,
+                         long milliseconds);
+
+/*
+ * @docgen: function
+ * @brief: cancel a timer
+ * @name: libproc_timer_cancel
+ *
+ * #include: libproc.h
+ *
+ * @description
+ * @This function will take a timer out of the wheel, so that it does not
+ * @expire. Cancelling a timer that is not started does nothing.
+ * @description
+ *
+ * @error: timers is NULL
+ * @error: timer is NULL
+ *
+ * @param timers: the wheel the timer is in
+ * @type: struct LibprocTimers *
+ *
+ * @param timer: the timer to cancel
+ * @type: struct LibprocTimer *
+*/
+void libproc_timer_cancel(struct LibprocTimers *timers, struct LibprocTimer *timer);
+
+/*
+ * @docgen: function
+ * @brief: get the time until the next timer expires
+ * @name: libproc_timers_next
+ *
+ * #include: libproc.h
+ *
+ * @description
+ * @This function will return the number of milliseconds until the wheel
+ * @has to be turned again, which is suitable as a timeout for poll(2).
+ * @Timers in the upper levels of the wheel can make this earlier than
+ * @the timer actually expires, but never later.
+ * @description
+ *
+ * @error: timers is NULL
+ *
+ * @param timers: the wheel to check
+ * @type: struct LibprocTimers *
+ *
+ * @return: the milliseconds until the next expiry, or -1 if there is none
+ * @type: int
+*/
+int libproc_timers_next(struct LibprocTimers *timers);
+
+/*
+ * @docgen: function
+ * @brief: collect the timers that have expired
+ * @name: libproc_timers_expire
+ *
+ * #include: libproc.h
+ *
+ * @description
+ * @This function will turn the wheel to the current time of the
+ * @monotonic clock, and take every timer that expired on the way out
+ * @of it. The expired timers are returned as a list linked through
+ * @their next field, and are no longer started.
+ * @description
+ *
+ * @error: timers is NULL
+ *
+ * @param timers: the wheel to turn
+ * @type: struct LibprocTimers *
+ *
+ * @return: the expired timers, or NULL if there are none
+ * @type: struct LibprocTimer *
+*/
+struct LibprocTimer *libproc_timers_expire(struct LibprocTimers *timers);
+
 
 
 
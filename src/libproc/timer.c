@@ -0,0 +1,289 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Implementation of the hierarchical timing wheel. Time is counted in
+ * milliseconds since the wheel was made, and the wheel is turned one
+ * millisecond at a time. When the time reaches the start of a slot in
+ * an upper level, the timers in that slot are cascaded down into the
+ * levels below, until they reach the lowest level and expire.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "libproc.h"
+
+#define LEVEL_SHIFT(level) \
+    ((level) * LIBPROC_WHEEL_BITS)
+
+#define LEVEL_SLOT(time, level) \
+    ((int) (((time) >> LEVEL_SHIFT((level))) & (LIBPROC_WHEEL_SLOTS - 1)))
+
+/* How far ahead of the wheel a timer can be kept in the right slot */
+#define WHEEL_SPAN \
+    (1L << LEVEL_SHIFT(LIBPROC_WHEEL_LEVELS))
+
+static long monotonic_milliseconds(struct LibprocTimers *timers) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec now;
+
+    if(clock_gettime(CLOCK_MONOTONIC, &now) == -1)
+        liberror_failure(monotonic_milliseconds, clock_gettime);
+
+    return (now.tv_sec - timers->origin) * 1000L + now.tv_nsec / 1000000L;
+#else
+    return ((long) time(NULL) - timers->origin) * 1000L;
+#endif
+}
+
+static int timers_length(struct LibprocTimers *timers) {
+    int level = 0;
+    int length = 0;
+
+    for(level = 0; level < LIBPROC_WHEEL_LEVELS; level++) {
+        length += timers->counts[level];
+    }
+
+    return length;
+}
+
+/*
+ * Put a timer in the slot it belongs in from the current time of the
+ * wheel, which is the lowest level whose turn reaches it.
+*/
+static void timer_link(struct LibprocTimers *timers, struct LibprocTimer *timer) {
+    int level = 0;
+    long when = timer->expires;
+    long delta = timer->expires - timers->now;
+
+    if(delta >= WHEEL_SPAN) {
+        when = timers->now + WHEEL_SPAN - 1;
+        delta = WHEEL_SPAN - 1;
+    }
+
+    while(level < LIBPROC_WHEEL_LEVELS - 1 && delta >= 1L << LEVEL_SHIFT(level + 1)) {
+        level++;
+    }
+
+    timer->level = level;
+    timer->slot = LEVEL_SLOT(when, level);
+    timer->previous = NULL;
+    timer->next = timers->slots[level][timer->slot];
+
+    if(timer->next != NULL)
+        timer->next->previous = timer;
+
+    timers->slots[level][timer->slot] = timer;
+    timers->counts[level]++;
+}
+
+static void timer_unlink(struct LibprocTimers *timers, struct LibprocTimer *timer) {
+    if(timer->previous != NULL)
+        timer->previous->next = timer->next;
+    else
+        timers->slots[timer->level][timer->slot] = timer->next;
+
+    if(timer->next != NULL)
+        timer->next->previous = timer->previous;
+
+    timers->counts[timer->level]--;
+    timer->level = -1;
+    timer->next = NULL;
+    timer->previous = NULL;
+}
+
+void libproc_timers_init(struct LibprocTimers *timers) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec now;
+#endif
+
+    liberror_is_null(libproc_timers_init, timers);
+
+    memset(timers, 0, sizeof(*timers));
+
+#if defined(CLOCK_MONOTONIC)
+    if(clock_gettime(CLOCK_MONOTONIC, &now) == -1)
+        liberror_failure(libproc_timers_init, clock_gettime);
+
+    timers->origin = now.tv_sec;
+#else
+    timers->origin = (long) time(NULL);
+#endif
+
+    timers->now = monotonic_milliseconds(timers);
+}
+
+void libproc_timer_init(struct LibprocTimer *timer) {
+    liberror_is_null(libproc_timer_init, timer);
+
+    timer->expires = 0;
+    timer->level = -1;
+    timer->slot = 0;
+    timer->next = NULL;
+    timer->previous = NULL;
+}
+
+void libproc_timer_start(struct LibprocTimers *timers, struct LibprocTimer *timer,
+                         long milliseconds) {
+    liberror_is_null(libproc_timer_start, timers);
+    liberror_is_null(libproc_timer_start, timer);
+    liberror_is_negative(libproc_timer_start, milliseconds);
+
+    libproc_timer_cancel(timers, timer);
+
+    /* The slot for the current time of the wheel has already been
+     * expired, so a timer has to go at least one slot past it. */
+    timer->expires = monotonic_milliseconds(timers) + milliseconds;
+
+    if(timer->expires <= timers->now)
+        timer->expires = timers->now + 1;
+
+    timer_link(timers, timer);
+}
+
+void libproc_timer_cancel(struct LibprocTimers *timers, struct LibprocTimer *timer) {
+    liberror_is_null(libproc_timer_cancel, timers);
+    liberror_is_null(libproc_timer_cancel, timer);
+
+    if(timer->level < 0)
+        return;
+
+    timer_unlink(timers, timer);
+}
+
+int libproc_timers_next(struct LibprocTimers *timers) {
+    int level = 0;
+    long next = -1;
+    long now = 0;
+
+    liberror_is_null(libproc_timers_next, timers);
+
+    /* The lowest level knows exactly when its timers expire, but an
+     * upper level only knows when its next slot with timers in it will
+     * be cascaded. */
+    for(level = 0; level < LIBPROC_WHEEL_LEVELS; level++) {
+        int offset = 0;
+        long base = timers->now >> LEVEL_SHIFT(level);
+
+        if(timers->counts[level] == 0)
+            continue;
+
+        for(offset = 1; offset <= LIBPROC_WHEEL_SLOTS; offset++) {
+            if(timers->slots[level][LEVEL_SLOT(base + offset, 0)] == NULL)
+                continue;
+
+            if(next == -1 || (base + offset) << LEVEL_SHIFT(level) < next)
+                next = (base + offset) << LEVEL_SHIFT(level);
+
+            break;
+        }
+    }
+
+    if(next == -1)
+        return -1;
+
+    /* The wheel is only turned when timers are collected, so it can be
+     * behind the clock. */
+    now = monotonic_milliseconds(timers);
+
+    return next <= now ? 0 : (int) (next - now);
+}
+
+struct LibprocTimer *libproc_timers_expire(struct LibprocTimers *timers) {
+    long target = 0;
+    struct LibprocTimer *expired = NULL;
+
+    liberror_is_null(libproc_timers_expire, timers);
+
+    target = monotonic_milliseconds(timers);
+
+    while(timers->now < target) {
+        int level = 0;
+        struct LibprocTimer *timer = NULL;
+
+        if(timers_length(timers) == 0) {
+            timers->now = target;
+
+            break;
+        }
+
+        /* Nothing can happen before the next slot of the second level
+         * is cascaded when the lowest level is empty. */
+        if(timers->counts[0] == 0) {
+            long cascade = ((timers->now >> LIBPROC_WHEEL_BITS) + 1) << LIBPROC_WHEEL_BITS;
+
+            if(cascade > target) {
+                timers->now = target;
+
+                break;
+            }
+
+            timers->now = cascade - 1;
+        }
+
+        timers->now++;
+
+        /* Cascade from the top, so that timers falling out of an upper
+         * level can land in a slot of a lower level that is about to be
+         * cascaded as well. */
+        for(level = LIBPROC_WHEEL_LEVELS - 1; level > 0; level--) {
+            int slot = LEVEL_SLOT(timers->now, level);
+
+            if((timers->now & ((1L << LEVEL_SHIFT(level)) - 1)) != 0)
+                continue;
+
+            while((timer = timers->slots[level][slot]) != NULL) {
+                timer_unlink(timers, timer);
+                timer_link(timers, timer);
+            }
+        }
+
+        while((timer = timers->slots[0][LEVEL_SLOT(timers->now, 0)]) != NULL) {
+            timer_unlink(timers, timer);
+            timer->next = expired;
+            expired = timer;
+        }
+    }
+
+    return expired;
+}
@@ -35,23 +35,60 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#include <signal.h>
+#include <limits.h>
 #include <stdlib.h>
-#include <sys/wait.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "catalyst.h"
 #include "jobs/jobs.h"
 #include "common/common.h"
 #include "parsers/parsers.h"
 
-void handle_sigchild(int x) {
-    wait(NULL);
+static const char *usage =
+    "usage: catalyst [-h] [-j jobs]\n"
+    "\n"
+    "Run the testcases in the '.catalyst' file of the current directory.\n"
+    "\n"
+    "options:\n"
+    "    -h         show this help and exit\n"
+    "    -j jobs    run up to this many testcases at once (defaults to the\n"
+    "               number of processors that are online)\n";
 
-    /* Reinstall signal handler because UNIX sucks */
-    signal(SIGCHLD, handle_sigchild);
+/*
+ * The number of test runners to run at once is given with '-j', and
+ * defaults to the number of processors that are online. '-h' prints
+ * the usage and exits.
+*/
+int parse_limit(int argc, char **argv) {
+    long limit = sysconf(_SC_NPROCESSORS_ONLN);
+    char *end = NULL;
+
+    if(argc == 1)
+        return limit < 1 ? 1 : (int) limit;
+
+    if(argc == 2 && strcmp(argv[1], "-h") == 0) {
+        printf("%s", usage);
+        exit(EXIT_SUCCESS);
+    }
+
+    if(argc != 3 || strcmp(argv[1], "-j") != 0) {
+        fprintf(stderr, "%s", usage);
+        exit(EXIT_FAILURE);
+    }
+
+    limit = strtol(argv[2], &end, 10);
+
+    if(*argv[2] == '\0' || *end != '\0' || limit < 1 || limit > INT_MAX) {
+        fprintf(stderr, "catalyst: invalid number of jobs '%s'\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) limit;
 }
 
-int main(void) {
+int main(int argc, char **argv) {
+    int limit = parse_limit(argc, argv);
     struct Configuration configuration;
 
     if(libpath_exists(CONFIGURATION_FILE) == 0) {
@@ -59,12 +96,10 @@ int main(void) {
         exit(EXIT_FAILURE);
     }
 
-    signal(SIGCHLD, handle_sigchild);
-
     configuration = parse_configuration(CONFIGURATION_FILE);
 
     verify_testcase_validity(configuration);
-    handle_jobs(configuration);
+    handle_jobs(configuration, limit);
     free_configuration(configuration);
 
     return EXIT_SUCCESS;
@@ -0,0 +1,637 @@
+/*
+ * C-Ware License
+ * 
+ * Copyright (c) 2022, C-Ware
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions of modified source code must append a copyright notice in
+ *    the form of 'Copyright <YEAR> <NAME>' to each modified source file's
+ *    copyright notice, and the standalone license file if one exists.
+ * 
+ * A "redistribution" can be constituted as any version of the source code
+ * that is intended to comprise some other derivative work of this code. A
+ * fork created for the purpose of contributing to any version of the source
+ * does not constitute a truly "derivative work" and does not require listing.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Functions for caching a parsed configuration as a binary image. When the
+ * configuration file has not changed since the image was written, the image
+ * is mapped into memory and used in place, rather than parsing the file.
+ *
+ * The image is every structure of the configuration laid out back to back
+ * after a header, where each pointer is stored as an offset from the start
+ * of the image. Loading an image is just a matter of adding the address it
+ * was mapped at to each of those offsets, which does not allocate anything.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../catalyst.h"
+#include "../common/common.h"
+#include "parsers.h"
+
+#define CACHE_MAGIC         "CATCACHE"
+#define CACHE_VERSION       8
+#define CACHE_ALIGNMENT     16
+#define CACHE_INITIAL_SIZE  4096
+
+/* Strings written to the image, by where they were in memory */
+#define CACHE_STRING_TYPE               struct CacheString
+#define CACHE_STRING_HEAP               1
+#define CACHE_STRING_FREE(value)
+#define CACHE_STRING_HASH(value)        \
+    (((unsigned long) (value).contents >> 4) ^ ((unsigned long) (value).contents >> 20))
+#define CACHE_STRING_COMPARE(a, b)      \
+    ((a).contents == (b).contents && (a).length == (b).length)
+
+/* Turn an offset stored in a pointer field back into a pointer to count
+ * elements, or reject the image if they are not all inside of it. NULL
+ * pointers are stored as offset 0, which is always the header. */
+#define RELOCATE(image, pointer, count)                                                         \
+    if((pointer) != NULL) {                                                                     \
+        if(cache_extent((image), (unsigned long) (pointer), sizeof(*(pointer)), (count)) == 0)  \
+            return 0;                                                                           \
+                                                                                                \
+        (pointer) = (void *) ((image).base + (unsigned long) (pointer));                        \
+    }
+
+/*
+ * @docgen: structure
+ * @brief: the header at the start of a cache image
+ * @name: CacheHeader
+ *
+ * @field magic[8]: identifies the file as a cache image
+ * @type: char
+ *
+ * @field version: the version of the image format
+ * @type: unsigned long
+ *
+ * @field layout: the sizes of the structures in the image
+ * @type: unsigned long
+ *
+ * @field length: the length of the entire image
+ * @type: unsigned long
+ *
+ * @field key: the key of the configuration file the image is for
+ * @type: struct ConfigurationKey
+ *
+ * @field jobs: the offset of the jobs array
+ * @type: unsigned long
+ *
+ * @field testcases: the offset of the testcases array
+ * @type: unsigned long
+*/
+struct CacheHeader {
+    char magic[8];
+    unsigned long version;
+    unsigned long layout;
+    unsigned long length;
+    struct ConfigurationKey key;
+    unsigned long jobs;
+    unsigned long testcases;
+};
+
+/*
+ * @docgen: structure
+ * @brief: a string that has been written to a cache image
+ * @name: CacheString
+ *
+ * @field contents: the contents of the string in memory
+ * @type: const char *
+ *
+ * @field length: the length of the string
+ * @type: int
+ *
+ * @field offset: the offset of the string in the image
+ * @type: unsigned long
+*/
+struct CacheString {
+    const char *contents;
+    int length;
+    unsigned long offset;
+};
+
+/*
+ * @docgen: structure
+ * @brief: table of the strings written to a cache image
+ * @name: CacheStrings
+ *
+ * @field length: the number of strings in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
+ * @type: int
+ *
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the strings
+ * @type: struct CacheString *
+*/
+struct CacheStrings {
+    int length;
+    int used;
+    int capacity;
+    unsigned char *states;
+    struct CacheString *contents;
+};
+
+/*
+ * @docgen: structure
+ * @brief: a growing buffer that a cache image is built in
+ * @name: CacheWriter
+ *
+ * @field buffer: the image being built
+ * @type: char *
+ *
+ * @field length: the length of the image
+ * @type: unsigned long
+ *
+ * @field capacity: the capacity of the buffer
+ * @type: unsigned long
+ *
+ * @field strings: the strings written so far
+ * @type: struct CacheStrings *
+*/
+struct CacheWriter {
+    char *buffer;
+    unsigned long length;
+    unsigned long capacity;
+    struct CacheStrings *strings;
+};
+
+/*
+ * @docgen: structure
+ * @brief: a cache image that has been mapped into memory
+ * @name: CacheImage
+ *
+ * @field base: the address the image was mapped at
+ * @type: char *
+ *
+ * @field length: the length of the image
+ * @type: unsigned long
+*/
+struct CacheImage {
+    char *base;
+    unsigned long length;
+};
+
+/*
+ * The layout of the image depends on the size of pointers and on the
+ * structures themselves, so an image written by a different build of
+ * catalyst must not be used.
+*/
+static unsigned long cache_layout(void) {
+    return (unsigned long) sizeof(void *)
+         | ((unsigned long) sizeof(struct CString) << 4)
+         | ((unsigned long) sizeof(struct Job) << 10)
+         | ((unsigned long) sizeof(struct Testcase) << 18);
+}
+
+/*
+ * Reserve size bytes of zeroed memory in the image, and return the offset
+ * of the reservation. The buffer can move, so offsets must be used rather
+ * than pointers until the image is finished.
+*/
+static unsigned long cache_reserve(struct CacheWriter *writer, unsigned long size) {
+    unsigned long offset = (writer->length + CACHE_ALIGNMENT - 1) & ~((unsigned long) CACHE_ALIGNMENT - 1);
+
+    if(offset + size > writer->capacity) {
+        char *buffer = NULL;
+        unsigned long capacity = writer->capacity;
+
+        while(offset + size > capacity)
+            capacity *= 2;
+
+        if((buffer = realloc(writer->buffer, capacity)) == NULL)
+            liberror_failure(cache_reserve, realloc);
+
+        writer->buffer = buffer;
+        memset(writer->buffer + writer->capacity, 0, capacity - writer->capacity);
+        writer->capacity = capacity;
+    }
+
+    writer->length = offset + size;
+
+    return offset;
+}
+
+/*
+ * The parser interns strings, so a string that appears many times in the
+ * configuration is at one place in memory, and only needs to be written
+ * to the image once. Strings in the image belong to its mapping, and have
+ * no capacity of their own, like the arena's.
+*/
+static struct CString cache_write_cstring(struct CacheWriter *writer, struct CString cstring) {
+    int location = 0;
+    struct CacheString written;
+
+    if(cstring.contents == NULL)
+        return cstring;
+
+    written.contents = cstring.contents;
+    written.length = cstring.length;
+    chashmap_find(writer->strings, written, location, CACHE_STRING);
+
+    if(location != CHASHMAP_NOT_FOUND) {
+        written = writer->strings->contents[location];
+    } else {
+        written.offset = cache_reserve(writer, cstring.length + 1);
+        memcpy(writer->buffer + written.offset, cstring.contents, cstring.length);
+        chashmap_insert(writer->strings, written, CACHE_STRING);
+    }
+
+    cstring.capacity = 0;
+    cstring.contents = (char *) written.offset;
+
+    return cstring;
+}
+
+static unsigned long cache_write_cstrings(struct CacheWriter *writer, struct CStrings *cstrings) {
+    int index = 0;
+    unsigned long array = 0;
+    unsigned long contents = 0;
+    struct CStrings stored;
+
+    if(cstrings == NULL)
+        return 0;
+
+    array = cache_reserve(writer, sizeof(struct CStrings));
+    contents = cache_reserve(writer, sizeof(struct CString) * carray_length(cstrings));
+
+    for(index = 0; index < carray_length(cstrings); index++) {
+        struct CString cstring = cache_write_cstring(writer, cstrings->contents[index]);
+
+        memcpy(writer->buffer + contents + sizeof(struct CString) * index, &cstring,
+               sizeof(struct CString));
+    }
+
+    stored.length = carray_length(cstrings);
+    stored.capacity = carray_length(cstrings);
+    stored.contents = (struct CString *) contents;
+    memcpy(writer->buffer + array, &stored, sizeof(struct CStrings));
+
+    return array;
+}
+
+static unsigned long cache_write_argvs(struct CacheWriter *writer, struct Argvs *argvs) {
+    int index = 0;
+    unsigned long array = 0;
+    unsigned long contents = 0;
+    struct Argvs stored;
+
+    if(argvs == NULL)
+        return 0;
+
+    array = cache_reserve(writer, sizeof(struct Argvs));
+    contents = cache_reserve(writer, sizeof(struct CStrings *) * carray_length(argvs));
+
+    for(index = 0; index < carray_length(argvs); index++) {
+        struct CStrings *argv = (struct CStrings *) cache_write_cstrings(writer, argvs->contents[index]);
+
+        memcpy(writer->buffer + contents + sizeof(struct CStrings *) * index, &argv,
+               sizeof(struct CStrings *));
+    }
+
+    stored.length = carray_length(argvs);
+    stored.capacity = carray_length(argvs);
+    stored.contents = (struct CStrings **) contents;
+    memcpy(writer->buffer + array, &stored, sizeof(struct Argvs));
+
+    return array;
+}
+
+static unsigned long cache_write_jobs(struct CacheWriter *writer, struct Jobs *jobs) {
+    int index = 0;
+    unsigned long array = cache_reserve(writer, sizeof(struct Jobs));
+    unsigned long contents = cache_reserve(writer, sizeof(struct Job) * carray_length(jobs));
+    struct Jobs stored;
+
+    for(index = 0; index < carray_length(jobs); index++) {
+        struct Job job = jobs->contents[index];
+
+        job.name = cache_write_cstring(writer, job.name);
+        job.make_path = cache_write_cstring(writer, job.make_path);
+        job.make_arguments = (struct CStrings *) cache_write_cstrings(writer, job.make_arguments);
+
+        memcpy(writer->buffer + contents + sizeof(struct Job) * index, &job, sizeof(struct Job));
+    }
+
+    stored.length = carray_length(jobs);
+    stored.capacity = carray_length(jobs);
+    stored.contents = (struct Job *) contents;
+    memcpy(writer->buffer + array, &stored, sizeof(struct Jobs));
+
+    return array;
+}
+
+static unsigned long cache_write_testcases(struct CacheWriter *writer, struct Testcases *testcases) {
+    int index = 0;
+    unsigned long array = cache_reserve(writer, sizeof(struct Testcases));
+    unsigned long contents = cache_reserve(writer, sizeof(struct Testcase) * carray_length(testcases));
+    struct Testcases stored;
+
+    for(index = 0; index < carray_length(testcases); index++) {
+        struct Testcase testcase = testcases->contents[index];
+
+        testcase.path = cache_write_cstring(writer, testcase.path);
+        testcase.name = cache_write_cstring(writer, testcase.name);
+        testcase.argv = (struct CStrings *) cache_write_cstrings(writer, testcase.argv);
+        testcase.input = cache_write_cstring(writer, testcase.input);
+        testcase.output = cache_write_cstring(writer, testcase.output);
+        testcase.argvs = (struct Argvs *) cache_write_argvs(writer, testcase.argvs);
+        testcase.inputs = (struct CStrings *) cache_write_cstrings(writer, testcase.inputs);
+        testcase.outputs = (struct CStrings *) cache_write_cstrings(writer, testcase.outputs);
+
+        memcpy(writer->buffer + contents + sizeof(struct Testcase) * index, &testcase,
+               sizeof(struct Testcase));
+    }
+
+    stored.length = carray_length(testcases);
+    stored.capacity = carray_length(testcases);
+    stored.contents = (struct Testcase *) contents;
+    memcpy(writer->buffer + array, &stored, sizeof(struct Testcases));
+
+    return array;
+}
+
+/*
+ * An image with the right header can still have been cut short, or be
+ * damaged, so every offset that is read from it is checked to be inside
+ * of it, past the header, and aligned like everything written to it is.
+*/
+static int cache_extent(struct CacheImage image, unsigned long offset, unsigned long size,
+                        long count) {
+    if(count < 0 || offset < sizeof(struct CacheHeader) || offset > image.length ||
+       offset % CACHE_ALIGNMENT != 0) {
+        return 0;
+    }
+
+    return (unsigned long) count <= (image.length - offset) / size;
+}
+
+static int cache_relocate_cstring(struct CacheImage image, struct CString *cstring) {
+    if(cstring->contents == NULL)
+        return 1;
+
+    /* The NUL at the end is part of the string in the image */
+    if(cstring->length < 0)
+        return 0;
+
+    RELOCATE(image, cstring->contents, (long) cstring->length + 1);
+
+    return cstring->contents[cstring->length] == '\0';
+}
+
+static int cache_relocate_cstrings(struct CacheImage image, struct CStrings **cstrings) {
+    int index = 0;
+
+    RELOCATE(image, *cstrings, 1);
+
+    if(*cstrings == NULL)
+        return 1;
+
+    RELOCATE(image, (*cstrings)->contents, (*cstrings)->length);
+
+    for(index = 0; index < carray_length(*cstrings); index++) {
+        if(cache_relocate_cstring(image, (*cstrings)->contents + index) == 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int cache_relocate_argvs(struct CacheImage image, struct Argvs **argvs) {
+    int index = 0;
+
+    RELOCATE(image, *argvs, 1);
+
+    if(*argvs == NULL)
+        return 1;
+
+    RELOCATE(image, (*argvs)->contents, (*argvs)->length);
+
+    for(index = 0; index < carray_length(*argvs); index++) {
+        if(cache_relocate_cstrings(image, (*argvs)->contents + index) == 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int cache_relocate_configuration(struct CacheImage image,
+                                       struct Configuration *configuration) {
+    int index = 0;
+
+    RELOCATE(image, configuration->jobs, 1);
+    RELOCATE(image, configuration->testcases, 1);
+
+    if(configuration->jobs == NULL || configuration->testcases == NULL)
+        return 0;
+
+    RELOCATE(image, configuration->jobs->contents, configuration->jobs->length);
+    RELOCATE(image, configuration->testcases->contents, configuration->testcases->length);
+
+    for(index = 0; index < carray_length(configuration->jobs); index++) {
+        struct Job *job = configuration->jobs->contents + index;
+
+        if(cache_relocate_cstring(image, &job->name) == 0 ||
+           cache_relocate_cstring(image, &job->make_path) == 0 ||
+           cache_relocate_cstrings(image, &job->make_arguments) == 0) {
+            return 0;
+        }
+    }
+
+    for(index = 0; index < carray_length(configuration->testcases); index++) {
+        struct Testcase *testcase = configuration->testcases->contents + index;
+
+        if(cache_relocate_cstring(image, &testcase->path) == 0 ||
+           cache_relocate_cstring(image, &testcase->name) == 0 ||
+           cache_relocate_cstring(image, &testcase->input) == 0 ||
+           cache_relocate_cstring(image, &testcase->output) == 0 ||
+           cache_relocate_cstrings(image, &testcase->argv) == 0 ||
+           cache_relocate_cstrings(image, &testcase->inputs) == 0 ||
+           cache_relocate_cstrings(image, &testcase->outputs) == 0 ||
+           cache_relocate_argvs(image, &testcase->argvs) == 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+struct ConfigurationKey configuration_key(const char *path, struct CString source) {
+    struct stat status;
+    struct ConfigurationKey key;
+
+    liberror_is_null(configuration_key, path);
+    liberror_is_null(configuration_key, source.contents);
+
+    INIT_VARIABLE(key);
+    INIT_VARIABLE(status);
+
+    if(stat(path, &status) == -1)
+        liberror_failure(configuration_key, stat);
+
+    key.size = (unsigned long) status.st_size;
+    key.mtime = (unsigned long) status.st_mtime;
+    key.hash = hash_bytes(source.contents, source.length);
+
+    return key;
+}
+
+int load_configuration_cache(const char *path, struct ConfigurationKey key,
+                             struct Configuration *configuration) {
+    int descriptor = -1;
+    struct stat status;
+    struct CacheImage image;
+    struct CacheHeader header;
+
+    liberror_is_null(load_configuration_cache, path);
+    liberror_is_null(load_configuration_cache, configuration);
+
+    if((descriptor = open(path, O_RDONLY)) == -1)
+        return 0;
+
+    /* The header has to be there, and it has to describe this file, and
+     * this build of catalyst. */
+    if(fstat(descriptor, &status) == -1 || status.st_size < (long) sizeof(header) ||
+       read(descriptor, &header, sizeof(header)) != sizeof(header)) {
+        close(descriptor);
+
+        return 0;
+    }
+
+    if(memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != CACHE_VERSION || header.layout != cache_layout() ||
+       header.length != (unsigned long) status.st_size ||
+       header.key.size != key.size || header.key.mtime != key.mtime ||
+       header.key.hash != key.hash) {
+        close(descriptor);
+
+        return 0;
+    }
+
+    /* Private mapping, so that relocating the image only changes our
+     * copy of the pages that hold pointers. */
+    image.length = header.length;
+    image.base = mmap(NULL, header.length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+
+    if(image.base == MAP_FAILED)
+        return 0;
+
+    configuration->jobs = (struct Jobs *) header.jobs;
+    configuration->testcases = (struct Testcases *) header.testcases;
+
+    /* A damaged image is thrown away, and the file is parsed instead */
+    if(cache_relocate_configuration(image, configuration) == 0) {
+        munmap(image.base, image.length);
+        configuration->jobs = NULL;
+        configuration->testcases = NULL;
+
+        return 0;
+    }
+
+    configuration->image = image.base;
+    configuration->image_length = (long) image.length;
+
+    return 1;
+}
+
+void store_configuration_cache(const char *path, struct ConfigurationKey key,
+                               struct Configuration configuration) {
+    int descriptor = -1;
+    unsigned long written = 0;
+    struct CacheHeader header;
+    struct CacheWriter writer;
+    struct CString temporary_path = cstring_init(path);
+    char pid[32 + 1] = "";
+
+    liberror_is_null(store_configuration_cache, path);
+
+    INIT_VARIABLE(header);
+    INIT_VARIABLE(writer);
+
+    writer.capacity = CACHE_INITIAL_SIZE;
+    writer.buffer = calloc(1, CACHE_INITIAL_SIZE);
+    writer.strings = chashmap_init(writer.strings, CACHE_STRING);
+
+    /* Header goes first so that its offset is zero */
+    cache_reserve(&writer, sizeof(struct CacheHeader));
+
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.layout = cache_layout();
+    header.key = key;
+    header.jobs = cache_write_jobs(&writer, configuration.jobs);
+    header.testcases = cache_write_testcases(&writer, configuration.testcases);
+    header.length = writer.length;
+    memcpy(writer.buffer, &header, sizeof(struct CacheHeader));
+
+    /* Write to a file unique to this process and rename it into place, so
+     * that a concurrent run never maps a half-written image. */
+    libc99_itoa((int) getpid(), pid, 32, 10);
+    cstring_concats(&temporary_path, ".");
+    cstring_concats(&temporary_path, pid);
+
+    if((descriptor = open(temporary_path.contents, O_WRONLY | O_CREAT | O_TRUNC, 0644)) != -1) {
+        while(written < writer.length) {
+            long status = write(descriptor, writer.buffer + written, writer.length - written);
+
+            if(status <= 0)
+                break;
+
+            written += status;
+        }
+
+        close(descriptor);
+
+        if(written != writer.length || rename(temporary_path.contents, path) == -1)
+            unlink(temporary_path.contents);
+    }
+
+    /* Not being able to write the cache is fine-- it just means that the
+     * next run has to parse the file again. */
+    errno = 0;
+
+    cstring_free(temporary_path);
+    free(writer.buffer);
+    chashmap_free(writer.strings, CACHE_STRING);
+}
+
+void free_configuration_cache(struct Configuration configuration) {
+    munmap(configuration.image, configuration.image_length);
+}
@@ -37,371 +37,422 @@
 
 /*
  * Functions for parsing a configuration file.
+ *
+ * The parser makes a single pass over the file, and validates the syntax
+ * of each line as it parses it. Character classes are looked up in a
+ * table rather than searched for in a string, and the names of qualifiers
+ * and keys are looked up in a perfect hash table.
+ *
+ * Fragment files pulled in by include directives are parsed on a pool of
+ * threads, each into an arena of its own, and merged afterwards.
 */
 
-#include <ctype.h>
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "../catalyst.h"
+#include "../common/common.h"
 #include "parsers.h"
 
+const unsigned char parser_character_classes[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x00, 0x08, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x10, 0x10, 0x10, 0x10, 0x13,
+    0x10, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x10, 0x10, 0x10, 0x10, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
 /*
- * @docgen: function
- * @brief: perform error checks on a qualifier
- * @name: error_check_qualifier
+ * Every name the parser understands, each at the slot that PARSER_HASH
+ * gives it. A name can mean something different in each context it is
+ * used in (like 'name'), and is QUALIFIER_UNKNOWN in contexts it cannot
+ * be used in. When a name is added, the PARSER_HASH_* constants must be
+ * changed so that no two names share a slot.
+*/
+static const struct ParserKey parser_keys[PARSER_KEY_TABLE_LENGTH] = {
+    {"timeout", 7, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_TIMEOUT}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"max_output_bytes", 16, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_OUTPUT_BYTES}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"file", 4, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_FILE}},
+    {"max_cpu_ms", 10, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_CPU_MS}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"job", 3, {QUALIFIER_JOB, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"stdout", 6, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_STDOUT}},
+    {"max_memory", 10, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_MEMORY}},
+    {"nice", 4, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_NICE}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"max_wall_ms", 11, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_WALL_MS}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"arguments", 9, {QUALIFIER_UNKNOWN, QUALIFIER_JOB_ARGUMENTS, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"forkserver", 10, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_FORKSERVER}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"cpus", 4, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_CPUS}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"argv", 4, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_ARGV}},
+    {"stdin_file", 10, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_STDIN_FILE}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"scratch", 7, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_SCRATCH}},
+    {"ionice", 6, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_IONICE}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"max_open_files", 14, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_OPEN_FILES}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"include", 7, {QUALIFIER_INCLUDE, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"testcase", 8, {QUALIFIER_TESTCASE, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"max_rss_kb", 10, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_RSS_KB}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"max_cpu_seconds", 15, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_MAX_CPU_SECONDS}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {"stdin", 5, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_TESTCASE_STDIN}},
+    {"make", 4, {QUALIFIER_UNKNOWN, QUALIFIER_JOB_MAKE, QUALIFIER_UNKNOWN}},
+    {"name", 4, {QUALIFIER_UNKNOWN, QUALIFIER_JOB_NAME, QUALIFIER_TESTCASE_NAME}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}},
+    {NULL, 0, {QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN, QUALIFIER_UNKNOWN}}
+};
+
+/*
+ * @docgen: structure
+ * @brief: fragment files shared between the threads that parse them
+ * @name: ParserPool
  *
- * @description
- * @This function will perform error checking on the cursor
- * @based off of its current position when the function is
- * @called. The function will enforce the regular expression
- * @
- * @[a-zA-Z_][a-zA-Z0-9_]*: {
- * @
- * @From the current position of the cursor, to the end of
- * @the line it is on.
- * @
- * @description
+ * @field lock: protects next
+ * @type: pthread_mutex_t
  *
- * @notes
- * @This function will not validate the type of qualifier that the
- * @line contains. Currently, the only two valid qualifiers that
- * @the parser can understand is 'job' and 'testcase'. The caller
- * @will be responsible for verifying that the qualifier is an
- * @acceptable name.
- * @
- * @Also, as should be expected by this function not taking a
- * @pointer to the cursor, this function will not modify the
- * @caller's cursor, and will instead use a copy of it.
- * @notes
+ * @field next: the index of the next fragment to parse
+ * @type: int
  *
- * @param cursor: the cursor to validate
- * @type: struct LibmatchCursor
+ * @field length: the number of fragments
+ * @type: int
+ *
+ * @field files: the paths of the fragments
+ * @type: struct LibpathFile *
+ *
+ * @field fragments: the parsed fragments, in the same order as files
+ * @type: struct Configuration *
 */
-void error_check_qualifier_header(struct LibmatchCursor cursor) {
-    int character = libmatch_cursor_getch(&cursor);
+struct ParserPool {
+    pthread_mutex_t lock;
+    int next;
+    int length;
+    struct LibpathFile *files;
+    struct Configuration *fragments;
+};
+
+static const char *context_names[PARSER_CONTEXTS] = {"qualifier", "job key", "testcase key"};
+
+/* The path of the file each thread is parsing, for error messages */
+static pthread_key_t parser_path_key;
+static pthread_once_t parser_path_once = PTHREAD_ONCE_INIT;
+
+static void create_parser_path_key(void) {
+    pthread_key_create(&parser_path_key, NULL);
+}
 
-    HANDLE_EOF(cursor);
+void parser_error(struct LibmatchCursor *cursor, const char *format, ...) {
+    va_list arguments;
 
-    /* First character must be in the character class [A-Za-z_] */
-    if(strchr(LIBMATCH_ALPHA "_", character) == NULL) {
-        fprintf(stderr, "catalyst: failed to parse configuration file-- first"
-                " character of qualifier name on line %i must be alphabetical"
-                " or an underscore.\n", cursor.line);
-        exit(EXIT_FAILURE);
-    }
+    va_start(arguments, format);
+    fprintf(stderr, "catalyst: failed to parse configuration file '%s'-- ",
+            (const char *) pthread_getspecific(parser_path_key));
+    vfprintf(stderr, format, arguments);
+    fprintf(stderr, " (line %i, column %i)\n", libmatch_cursor_line(cursor) + 1,
+            libmatch_cursor_column(cursor));
+    va_end(arguments);
 
-    character = libmatch_cursor_getch(&cursor);
+    exit(EXIT_FAILURE);
+}
 
-    /* All of the characters after the first one until a colon must be
-     * alphanumeric, or an underscore. */
-    while(1) {
-        HANDLE_EOF(cursor);
+const char *describe_character(int character, char buffer[PARSER_DESCRIPTION_LENGTH + 1]) {
+    switch(character) {
+        case LIBMATCH_EOF:
+            return "EOF";
+        case '\n':
+            return "a new line";
+        case ' ':
+            return "a space";
+    }
 
-        if(character == ':')
-            break;
+    buffer[0] = '\'';
+    buffer[1] = (char) character;
+    buffer[2] = '\'';
+    buffer[3] = '\0';
 
-        if(strchr(LIBMATCH_ALPHANUM "_", character) == NULL) {
-            fprintf(stderr, "catalyst: failed to parse configuration file-- every"
-                    " character after the start of a qualifier name on line %i"
-                    " must be alphanumerical, or an underscore.\n", cursor.line);
-            exit(EXIT_FAILURE);
-        }
+    return buffer;
+}
 
-        character = libmatch_cursor_getch(&cursor);
+void expect_character(struct LibmatchCursor *cursor, int character, const char *expected) {
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
+    int next = PARSER_PEEK(cursor);
+
+    if(next != character) {
+        parser_error(cursor, "expected %s, got %s", expected,
+                     describe_character(next, description));
     }
 
-    /* We only get to this point if the a colon was met, so we can
-     * assume that a colon was found. Next character after it must
-     * be a space. */
-    ASSERT_NEXT_CHARACTER(&cursor, ' ');
-    ASSERT_NEXT_CHARACTER(&cursor, '{');
-    ASSERT_NEXT_CHARACTER(&cursor, '\n');
+    libmatch_cursor_getch(cursor);
 }
 
 /*
  * @docgen: function
- * @brief: validate a line in a qualifier block
- * @name: error_check_qualifier_line
+ * @brief: parse and enumerate a qualifier or key name
+ * @name: parse_name
  *
  * @description
- * @This function will take the current position of the cursor inside
- * @of a qualifier block, and validate its general format to produce
- * @errors if it is incorrectly written.
+ * @This function will, with the cursor on the first character of the
+ * @name of a qualifier or key, parse the name and the ': ' after it,
+ * @enforcing the regular expression
+ * @
+ * @[a-zA-Z_][a-zA-Z0-9_]*: 
+ * @
+ * @The name is then looked up in the table of names, and the meaning
+ * @that it has in the context it was found in is returned.
  * @description
  *
- * @notes
- * @This function does not do any validation on the actualy data assigned
- * @to the value of the key. When it comes to the values of the key, all it
- * @does is check that SOMETHING is there.
- * @notes
+ * @param cursor: the cursor to parse from
+ * @type: struct LibmatchCursor *
  *
- * @param cursor: the cursor to read from
- * @type: struct LibmatchCursor
+ * @param context: the context the name appears in
+ * @type: int
+ *
+ * @return: the enumerated name, or QUALIFIER_UNKNOWN
+ * @type: int
 */
-void error_check_qualifier_line(struct LibmatchCursor cursor) {
-    int index = 0;
-    int character = -1;
-
-    /* Start of the line must have 4 pixels at the start */
-    while(index < 4) {
-        character = libmatch_cursor_getch(&cursor);
+int parse_name(struct LibmatchCursor *cursor, int context) {
+    int start = cursor->cursor;
+    int length = 0;
+    int character = PARSER_PEEK(cursor);
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
+    const struct ParserKey *key = NULL;
 
-        HANDLE_EOF(cursor);
-
-        if(character == ' ') {
-            index++;
-
-            continue;
-        }
+    /* First character must be in the character class [A-Za-z_] */
+    if(character == LIBMATCH_EOF || PARSER_IS(character, PARSER_CLASS_NAME_START) == 0) {
+        parser_error(cursor, "expected %s name to start with an alphabetical character or"
+                     " an underscore, got %s", context_names[context],
+                     describe_character(character, description));
+    }
 
-        fprintf(stderr, "catalyst: body line of qualifier at line %i must have 4 spaces at the start\n", cursor.line + 1);
-        exit(EXIT_FAILURE);
+    /* Every character after that until the colon must be in the
+     * character class [A-Za-z0-9_] */
+    while((character = PARSER_PEEK(cursor)) != LIBMATCH_EOF &&
+          PARSER_IS(character, PARSER_CLASS_NAME) == 1) {
+        libmatch_cursor_getch(cursor);
     }
 
-    character = libmatch_cursor_getch(&cursor);
-    HANDLE_EOF(cursor);
+    length = cursor->cursor - start;
 
-    /* First character after a space must be in the character class
-     * [A-Za-z0-9_]." */
-    if(strchr(LIBMATCH_ALPHA "_", character) == NULL) {
-       fprintf(stderr, "catalyst: expected alphabetical character or underscore"
-               " after initial 4 spaces on line %i, got %c\n", cursor.line + 1,
-               character);
-       exit(EXIT_FAILURE);
+    if(character != ':') {
+        parser_error(cursor, "expected %s name to only contain alphanumerical characters"
+                     " or underscores, and end with ':', got %s", context_names[context],
+                     describe_character(character, description));
     }
 
-    /* All characters after expression ' {4}[a-zA-Z_]' must fit in
-     * the character class [a-zA-Z0-9_] until a colon is reached. */
-    while((character = libmatch_cursor_getch(&cursor)) != ':') {
-        HANDLE_EOF(cursor);
+    libmatch_cursor_getch(cursor);
+    expect_character(cursor, ' ', "a space after ':'");
 
-        if(strchr(LIBMATCH_ALPHANUM "_", character) != NULL)
-            continue;
+    key = parser_keys + PARSER_HASH(cursor->buffer + start, length);
 
-        fprintf(stderr, "catalyst: expected alphanumerical character or underscore"
-               " after first character after initial 4 spaces on line %i, got %c\n", cursor.line + 1,
-               character);
-        exit(EXIT_FAILURE);
+    if(key->name != NULL && key->length == length &&
+       memcmp(key->name, cursor->buffer + start, length) == 0 &&
+       key->values[context] != QUALIFIER_UNKNOWN) {
+        return key->values[context];
     }
 
-    /* Everything else after the colon must follow the expression:
-     * ' [^\s]' */
-    ASSERT_NEXT_CHARACTER(&cursor, ' ');
+    /* Rewind to the name so that the error points at it */
+    libmatch_cursor_unwind(cursor, length + 2);
+    parser_error(cursor, "unknown %s '%.*s'", context_names[context], length,
+                 cursor->buffer + start);
 
-    character = libmatch_cursor_getch(&cursor);
-    HANDLE_EOF(cursor);
-
-    /* Not an invalid character */
-    if(strchr(LIBMATCH_WHITESPACE, character) == NULL)
-        return;
-
-    fprintf(stderr, "catalyst: expected non-empty value to key on line %i\n",
-            cursor.line + 1);
-    exit(EXIT_FAILURE);
+    return QUALIFIER_UNKNOWN;
 }
 
-
-
-
-
-
-
-
-
-
-
 /*
  * @docgen: function
- * @brief: enumerate the name of the qualifier
- * @name: enumerate_qualifier
+ * @brief: parse the start of a line in the body of a qualifier
+ * @name: parse_key
  *
  * @description
- * @This function will transform the name of the qualifier that
- * @the cursor is sitting on into a numeric value that can be
- * @easily used by the parser.
+ * @This function will, with the cursor at the start of a line inside of
+ * @a qualifier block, parse the 4 spaces of indentation and the name of
+ * @the key on the line, and make sure that a value follows it.
  * @description
  *
- * @notes
- * @This function will advance the cursor that the caller passes
- * @to it, as that makes the parsing process smoother.
- * @notes
- *
- * @param cursor: the cursor to enumerate
+ * @param cursor: the cursor to parse from
  * @type: struct LibmatchCursor *
  *
- * @return: the enumerated value, or QUALIFIER_UNKNOWN
+ * @param context: the kind of qualifier the line is in
+ * @type: int
+ *
+ * @return: the enumerated key
  * @type: int
 */
-int enumerate_qualifier(struct LibmatchCursor *cursor) {
-    int written = 0;
-    char qualifier_name[QUALIFIER_NAME_LENGTH + 1] = "";
-
-    written = libmatch_read_until(cursor, qualifier_name, QUALIFIER_NAME_LENGTH, ":");
+int parse_key(struct LibmatchCursor *cursor, int context) {
+    int index = 0;
+    int key = QUALIFIER_UNKNOWN;
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
+
+    /* Start of the line must have 4 spaces at the start */
+    for(index = 0; index < 4; index++) {
+        if(PARSER_PEEK(cursor) != ' ') {
+            parser_error(cursor, "body line of qualifier must have 4 spaces at the start,"
+                         " got %s", describe_character(PARSER_PEEK(cursor), description));
+        }
 
-    /* Make sure it did not overflow. */
-    if(written >= QUALIFIER_NAME_LENGTH) {
-        fprintf(stderr, "catalyst: qualifier name on line %i too long\n", cursor->line + 1);
-        exit(EXIT_FAILURE);
+        libmatch_cursor_getch(cursor);
     }
 
-    if(strcmp(qualifier_name, "job") == 0)
-        return QUALIFIER_JOB;
+    key = parse_name(cursor, context);
 
-    if(strcmp(qualifier_name, "testcase") == 0)
-        return QUALIFIER_TESTCASE;
+    /* Not an invalid character */
+    if(PARSER_PEEK(cursor) == LIBMATCH_EOF ||
+       PARSER_IS(PARSER_PEEK(cursor), PARSER_CLASS_WHITESPACE) == 1) {
+        parser_error(cursor, "expected non-empty value to key, got %s",
+                     describe_character(PARSER_PEEK(cursor), description));
+    }
 
-    return QUALIFIER_UNKNOWN;
+    return key;
 }
 
 /*
  * @docgen: function
- * @brief: enumerate the name of a job's key
- * @name: enumerate_job_key
+ * @brief: determine if a cursor is at the end of a qualifier
+ * @name: end_of_qualifier
  *
  * @description
- * @This function will, with the cursor on the first character of
- * @the name of the key, return an integer describing the name of
- * @the key.
+ * @This function will determine whether or not the cursor, given
+ * @its current position, is at the end of a block. If it is, the
+ * @cursor is advanced past the closing brace and the new line after
+ * @it.
  * @description
  *
- * @notes
- * @This function expects to be in the body of a JOB, so do not
- * @expect it to work with a testcase body.
- * @notes
- *
- * @param cursor: the cursor to enumerate through
+ * @param cursor: the cursor to check
  * @type: struct LibmatchCursor *
  *
- * @return: an integer describing the key, or QUALIFIER_UNKNOWN
+ * @return: 1 if its at the end of a qualifier, and 0 if its not
+ * @type: int
 */
-int enumerate_job_key(struct LibmatchCursor *cursor) {
-    int written = 0;
-    char job_key_name[JOB_KEY_NAME_LENGTH + 1] = "";
+int end_of_qualifier(struct LibmatchCursor *cursor) {
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
 
-    written = libmatch_read_until(cursor, job_key_name, JOB_KEY_NAME_LENGTH, ":");
+    if(PARSER_PEEK(cursor) == LIBMATCH_EOF)
+        parser_error(cursor, "expected '}' to close qualifier, got EOF");
 
-    /* Make sure it did not overflow. */
-    if(written >= JOB_KEY_NAME_LENGTH) {
-        fprintf(stderr, "catalyst: qualifier job key name on line %i too long\n", cursor->line + 1);
-        exit(EXIT_FAILURE);
-    }
+    if(PARSER_PEEK(cursor) != '}')
+        return 0;
 
-    if(strcmp(job_key_name, "name") == 0)
-        return QUALIFIER_JOB_NAME;
+    libmatch_cursor_getch(cursor);
 
-    if(strcmp(job_key_name, "make") == 0)
-        return QUALIFIER_JOB_MAKE;
+    if(PARSER_PEEK(cursor) != '\n' && PARSER_PEEK(cursor) != LIBMATCH_EOF) {
+        parser_error(cursor, "expected a new line after '}', got %s",
+                     describe_character(PARSER_PEEK(cursor), description));
+    }
 
-    if(strcmp(job_key_name, "arguments") == 0)
-        return QUALIFIER_JOB_ARGUMENTS;
+    libmatch_cursor_getch(cursor);
 
-    return QUALIFIER_UNKNOWN;
+    return 1;
 }
 
 /*
- * @docgen: function
- * @brief: enumerate the name of a testcase's key
- * @name: enumerate_testcase_key
- *
- * @description
- * @This function will, with the cursor on the first character of
- * @the name of the key, return an integer describing the name of
- * @the key.
- * @description
- *
- * @notes
- * @This function expects to be in the body of a TESTCASE, so do not
- * @expect it to work with a job body.
- * @notes
- *
- * @param cursor: the cursor to enumerate through
- * @type: struct LibmatchCursor *
- *
- * @return: an integer describing the key, or QUALIFIER_UNKNOWN
+ * Values are the last thing on their line.
 */
-int enumerate_testcase_key(struct LibmatchCursor *cursor) {
-    int written = 0;
-    char testcase_key_name[TESTCASE_KEY_NAME_LENGTH + 1] = "";
-
-    written = libmatch_read_until(cursor, testcase_key_name, TESTCASE_KEY_NAME_LENGTH, ":");
+void end_of_value(struct LibmatchCursor *cursor) {
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
 
-    /* Make sure it did not overflow. */
-    if(written >= TESTCASE_KEY_NAME_LENGTH) {
-        fprintf(stderr, "catalyst: qualifier testcase key name on line %i too long\n", cursor->line + 1);
-        exit(EXIT_FAILURE);
+    if(PARSER_PEEK(cursor) != '\n') {
+        parser_error(cursor, "expected a new line after value, got %s",
+                     describe_character(PARSER_PEEK(cursor), description));
     }
 
-    if(strcmp(testcase_key_name, "file") == 0)
-        return QUALIFIER_TESTCASE_FILE;
-
-    if(strcmp(testcase_key_name, "name") == 0)
-        return QUALIFIER_TESTCASE_NAME;
-
-    if(strcmp(testcase_key_name, "argv") == 0)
-        return QUALIFIER_TESTCASE_ARGV;
-
-    if(strcmp(testcase_key_name, "stdout") == 0)
-        return QUALIFIER_TESTCASE_STDOUT;
-
-    if(strcmp(testcase_key_name, "stdin") == 0)
-        return QUALIFIER_TESTCASE_STDIN;
-
-    if(strcmp(testcase_key_name, "timeout") == 0)
-        return QUALIFIER_TESTCASE_TIMEOUT;
-
-    return QUALIFIER_UNKNOWN;
+    libmatch_cursor_getch(cursor);
 }
 
 /*
- * @docgen: function
- * @brief: determine if a cursor is at the end of a qualifier
- * @name: end_of_qualifier
- *
- * @description
- * @This function will determine whether or not the cursor, given
- * @its current position, is at the end of a block.
- * @description
- *
- * @notes
- * @This function recieves a copy of the cursor, and so it will not
- * @modify the cursor of the caller.
- * @notes
- *
- * @param cursor: the cursor to check
- * @type: struct LibmatchCursor
- *
- * @return: 1 if its at the end of a qualifier, and 0 if its not
- * @type: int
+ * Read the whole configuration file into a buffer. Strings are parsed in
+ * place, and only the first of each distinct string is copied out of it,
+ * so it can be released once the file has been parsed.
 */
-int end_of_qualifier(struct LibmatchCursor cursor) {
-    int character = -1;
-
-    character = libmatch_cursor_getch(&cursor);
-    HANDLE_EOF(cursor);
-
-    if(character == '}') {
-        character = libmatch_cursor_getch(&cursor);
+struct CString read_configuration(const char *path) {
+    long length = 0;
+    FILE *stream = fopen(path, "r");
+    struct CString source;
 
-        if(character == '\n' || character == LIBMATCH_EOF)
-            return 1;
+    if(stream == NULL) {
+        fprintf(stderr, "catalyst: could not open configuration file '%s' (%s)\n", path,
+                strerror(errno));
+        exit(EXIT_FAILURE);
     }
 
-    return 0;
-}
-
-struct LibmatchCursor open_cursor_stream(const char *path) {
-    FILE *stream = fopen(path, "r");
-    struct LibmatchCursor cursor;
+    if(fseek(stream, 0, SEEK_END) == -1 || (length = ftell(stream)) == -1 ||
+       fseek(stream, 0, SEEK_SET) == -1) {
+        fprintf(stderr, "catalyst: could not read configuration file '%s' (%s)\n", path,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
 
-    INIT_VARIABLE(cursor);
-    cursor = libmatch_cursor_from_stream(stream);
+    source.contents = malloc((size_t) length + 1);
+    source.length = (int) fread(source.contents, 1, (size_t) length, stream);
+    source.capacity = 0;
+    source.contents[source.length] = '\0';
     fclose(stream);
 
-    return cursor;
+    return source;
 }
 
-
-
+/*
+ * Copy an array that was built up while parsing into the arena, at
+ * exactly its length.
+*/
+#define ADOPT_ARRAY(arena, array, scratch, type)                                        \
+do {                                                                                    \
+    (array) = arena_alloc((arena), sizeof(*(array)));                                   \
+    (array)->length = (scratch)->length;                                                \
+    (array)->capacity = (scratch)->length;                                              \
+    (array)->contents = arena_alloc((arena), sizeof(type) * (scratch)->length);         \
+    memcpy((array)->contents, (scratch)->contents, sizeof(type) * (scratch)->length);   \
+} while(0)
 
 /*
  * PARSING LOGIC
@@ -412,56 +463,28 @@ struct Job parse_job(struct LibmatchCursor *cursor, struct ParserState *state) {
 
     /* Prepare for parsing */
     INIT_VARIABLE(new_job);
-    cstring_reset(&state->line);
 
     /* We should be 'in' the body of the job, and so on the first
      * line of it. The actual format should have the closing brace
      * strictly at the start of the line, and be the only character
-     * except for the new line on it. So we can detect when to stop
-     * by reading a full line, and checking if it is "}\n". Otherwise,
-     * perform job line error checks.
-    */
-    while(end_of_qualifier(*cursor) == 0) {
-        int key = 0;
-
-        error_check_qualifier_line(*cursor);
-
-        /* 4 initial spaces on each line */
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
-
-        /* What kind of job key are we handling? */
-        if((key = enumerate_job_key(cursor)) == QUALIFIER_UNKNOWN) {
-            fprintf(stderr, "catalyst: unknown job qualifier key on line %i\n", cursor->line + 1);
-            exit(EXIT_FAILURE);
-        }
-
-        /* Go pass the space */
-        libmatch_cursor_getch(cursor);
-
-        /* Parse the value */
-        switch(key) {
+     * except for the new line on it. */
+    while(end_of_qualifier(cursor) == 0) {
+        switch(parse_key(cursor, PARSER_CONTEXT_JOB)) {
             case QUALIFIER_JOB_NAME:
-                new_job.name = parse_string(cursor);
-
-                libmatch_cursor_getch(cursor);
+                new_job.name = parse_string(cursor, state);
 
                 break;
             case QUALIFIER_JOB_MAKE:
-                new_job.make_path = parse_string(cursor);
-
-                libmatch_cursor_getch(cursor);
+                new_job.make_path = parse_string(cursor, state);
 
                 break;
             case QUALIFIER_JOB_ARGUMENTS:
-                new_job.make_arguments = parse_string_list(cursor);
-
-                libmatch_cursor_getch(cursor);
+                new_job.make_arguments = parse_string_list(cursor, state);
 
                 break;
         }
+
+        end_of_value(cursor);
     }
 
     return new_job;
@@ -472,146 +495,543 @@ struct Testcase parse_testcase(struct LibmatchCursor *cursor, struct ParserState
 
     /* Prepare for parsing */
     INIT_VARIABLE(new_testcase);
-    cstring_reset(&state->line);
+    new_testcase.cpus = 1;
+    new_testcase.ionice = TESTCASE_NO_IONICE;
+    state->argvs->length = 0;
+    state->inputs->length = 0;
+    state->outputs->length = 0;
 
-    /* We should be 'in' the body of the job, and so on the first
+    /* We should be 'in' the body of the testcase, and so on the first
      * line of it. The actual format should have the closing brace
      * strictly at the start of the line, and be the only character
-     * except for the new line on it. So we can detect when to stop
-     * by reading a full line, and checking if it is "}\n". Otherwise,
-     * perform job line error checks.
-    */
-    while(end_of_qualifier(*cursor) == 0) {
-        int key = 0;
+     * except for the new line on it. */
+    while(end_of_qualifier(cursor) == 0) {
+        switch(parse_key(cursor, PARSER_CONTEXT_TESTCASE)) {
+            case QUALIFIER_TESTCASE_FILE:
+                new_testcase.path = parse_string(cursor, state);
 
-        error_check_qualifier_line(*cursor);
+                break;
+            case QUALIFIER_TESTCASE_NAME:
+                new_testcase.name = parse_string(cursor, state);
 
-        /* 4 initial spaces on each line */
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
+                break;
+            case QUALIFIER_TESTCASE_ARGV: {
+                struct CStrings *argv = parse_string_list(cursor, state);
 
-        /* What kind of testcase key are we handling? */
-        if((key = enumerate_testcase_key(cursor)) == QUALIFIER_UNKNOWN) {
-            fprintf(stderr, "catalyst: unknown testcase qualifier key on line %i\n", cursor->line + 1);
-            exit(EXIT_FAILURE);
-        }
+                carray_append(state->argvs, argv, ARGV);
 
-        /* Go pass the space */
-        libmatch_cursor_getch(cursor);
+                break;
+            }
+            case QUALIFIER_TESTCASE_STDIN: {
+                struct CString input = parse_string(cursor, state);
 
-        /* Parse the value */
-        switch(key) {
-            case QUALIFIER_TESTCASE_FILE:
-                new_testcase.path = parse_string(cursor);
+                carray_append(state->inputs, input, CSTRING);
 
-                libmatch_cursor_getch(cursor);
+                break;
+            }
+            case QUALIFIER_TESTCASE_STDOUT: {
+                struct CString output = parse_string(cursor, state);
+
+                carray_append(state->outputs, output, CSTRING);
 
                 break;
+            }
+            case QUALIFIER_TESTCASE_TIMEOUT:
+                new_testcase.timeout = parse_integer(cursor);
 
-            case QUALIFIER_TESTCASE_NAME:
-                new_testcase.name = parse_string(cursor);
+                break;
+            case QUALIFIER_TESTCASE_SCRATCH:
+                if((new_testcase.scratch = parse_integer(cursor)) > 1)
+                    parser_error(cursor, "expected scratch to be 0 or 1");
 
-                libmatch_cursor_getch(cursor);
+                break;
+            case QUALIFIER_TESTCASE_STDIN_FILE:
+                if((new_testcase.stdin_file = parse_integer(cursor)) > 1)
+                    parser_error(cursor, "expected stdin_file to be 0 or 1");
+
+                break;
+            case QUALIFIER_TESTCASE_FORKSERVER:
+                if((new_testcase.forkserver = parse_integer(cursor)) > 1)
+                    parser_error(cursor, "expected forkserver to be 0 or 1");
+
+                break;
+            case QUALIFIER_TESTCASE_CPUS:
+                if((new_testcase.cpus = parse_integer(cursor)) == 0)
+                    parser_error(cursor, "expected cpus to be at least 1");
 
                 break;
+            case QUALIFIER_TESTCASE_NICE:
+                if((new_testcase.nice = parse_integer(cursor)) > TESTCASE_MAX_NICE)
+                    parser_error(cursor, "expected nice to be at most %i", TESTCASE_MAX_NICE);
 
-            case QUALIFIER_TESTCASE_ARGV:
-                new_testcase.argv = parse_string_list(cursor);
+                break;
+            case QUALIFIER_TESTCASE_IONICE:
+                if((new_testcase.ionice = parse_integer(cursor)) > TESTCASE_MAX_IONICE)
+                    parser_error(cursor, "expected ionice to be at most %i", TESTCASE_MAX_IONICE);
 
-                libmatch_cursor_getch(cursor);
+                break;
+            case QUALIFIER_TESTCASE_MAX_MEMORY:
+                new_testcase.max_memory = parse_ulong(cursor);
 
                 break;
-            case QUALIFIER_TESTCASE_STDIN:
-                new_testcase.input = parse_string(cursor);
+            case QUALIFIER_TESTCASE_MAX_CPU_SECONDS:
+                new_testcase.max_cpu_seconds = parse_uinteger(cursor);
 
-                libmatch_cursor_getch(cursor);
+                break;
+            case QUALIFIER_TESTCASE_MAX_OPEN_FILES:
+                new_testcase.max_open_files = parse_uinteger(cursor);
 
                 break;
-            case QUALIFIER_TESTCASE_STDOUT:
-                new_testcase.output = parse_string(cursor);
+            case QUALIFIER_TESTCASE_MAX_OUTPUT_BYTES:
+                new_testcase.max_output_bytes = parse_ulong(cursor);
 
-                libmatch_cursor_getch(cursor);
+                break;
+            case QUALIFIER_TESTCASE_MAX_WALL_MS:
+                new_testcase.max_wall_ms = parse_uinteger(cursor);
 
                 break;
-            case QUALIFIER_TESTCASE_TIMEOUT:
-                new_testcase.timeout = parse_uinteger(cursor);
+            case QUALIFIER_TESTCASE_MAX_CPU_MS:
+                new_testcase.max_cpu_ms = parse_uinteger(cursor);
+
+                break;
+            case QUALIFIER_TESTCASE_MAX_RSS_KB:
+                new_testcase.max_rss_kb = parse_uinteger(cursor);
 
                 break;
         }
+
+        end_of_value(cursor);
     }
 
+    /* Keys given more than once become the axes of a matrix. Only the
+     * axes are stored-- the combinations are made when the testcase is
+     * run. */
+    if(carray_length(state->argvs) > 0)
+        new_testcase.argv = state->argvs->contents[0];
+
+    if(carray_length(state->inputs) > 0)
+        new_testcase.input = state->inputs->contents[0];
+
+    if(carray_length(state->outputs) > 0)
+        new_testcase.output = state->outputs->contents[0];
+
+    if(carray_length(state->argvs) > 1)
+        ADOPT_ARRAY(state->arena, new_testcase.argvs, state->argvs, struct CStrings *);
+
+    if(carray_length(state->inputs) > 1)
+        ADOPT_ARRAY(state->arena, new_testcase.inputs, state->inputs, struct CString);
+
+    if(carray_length(state->outputs) > 1)
+        ADOPT_ARRAY(state->arena, new_testcase.outputs, state->outputs, struct CString);
+
     return new_testcase;
 }
 
-struct Configuration parse_configuration(const char *path) {
-    struct ParserState state;
-    struct LibmatchCursor cursor;
-    struct Configuration configuration;
+/*
+ * Expand the pattern of an include directive into the fragment files it
+ * matches, sorted by path so that the order does not depend on the order
+ * of the directory.
+*/
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const struct LibpathFile *) a)->path, ((const struct LibpathFile *) b)->path);
+}
 
-    liberror_is_null(parse_configuration, path);
+struct LibpathFiles expand_include(struct LibmatchCursor *cursor, struct ParserState *state,
+                                   struct CString pattern) {
+    const char *file_pattern = strrchr(pattern.contents, '/');
+    const char *configuration_name = strrchr(state->path, '/');
+    struct CString directory = cstring_init(".");
+    struct LibpathFiles files;
+
+    /* Patterns are relative to the directory of the configuration */
+    if(configuration_name != NULL) {
+        cstring_reset(&directory);
+        cstring_concats(&directory, state->path);
+        directory.length = (int) (configuration_name - state->path);
+        directory.contents[directory.length] = '\0';
+    }
 
-    INIT_VARIABLE(state);
-    INIT_VARIABLE(cursor);
-    INIT_VARIABLE(configuration);
+    if(file_pattern == NULL) {
+        file_pattern = pattern.contents;
+    } else {
+        if(memchr(pattern.contents, '*', file_pattern - pattern.contents) != NULL)
+            parser_error(cursor, "only the file name of an include pattern can contain '*'");
+
+        cstring_concats(&directory, LIBPATH_SEPARATOR);
+        cstring_concats(&directory, pattern.contents);
+        directory.length -= (int) strlen(file_pattern);
+        directory.contents[directory.length] = '\0';
+        file_pattern++;
+    }
 
-    /* Initialize stuff */
-    state.line = cstring_init("");
-    cursor = open_cursor_stream(path);
-    configuration.jobs = carray_init(configuration.jobs, JOB);
-    configuration.testcases = carray_init(configuration.testcases, TESTCASE);
+    if(libpath_exists(directory.contents) == 0)
+        parser_error(cursor, "include directory '%s' does not exist", directory.contents);
+
+    files = libpath_glob(directory.contents, file_pattern);
+    qsort(files.contents, (size_t) files.length, sizeof(struct LibpathFile), compare_files);
+    cstring_free(directory);
+
+    return files;
+}
+
+/*
+ * Parse the qualifiers of a file into the state.
+*/
+void parse_source(struct ParserState *state, struct CString source) {
+    struct LibmatchCursor cursor = libmatch_cursor_init(source.contents, source.length);
 
     /* Consume the file */
-    while(cursor.cursor < cursor.length) {
+    while(PARSER_PEEK(&cursor) != LIBMATCH_EOF) {
         int qualifier = 0;
-        int character = libmatch_cursor_getch(&cursor);
 
-        /* Keep going until a printable character is found. Also, 0x20
-         * is printable for some reason..? */
-        if(isprint(character) == 0 || character == ' ')
+        /* Keep going until a printable character is found. */
+        if(PARSER_IS(PARSER_PEEK(&cursor), PARSER_CLASS_PRINTABLE) == 0) {
+            libmatch_cursor_getch(&cursor);
+
             continue;
+        }
 
-        /* Currently, the cursor is AFTER the first alphabrtical
-         * character, which makes qualifier enumeration impossible,
-         * so lets push back once. */
-        libmatch_cursor_ungetch(&cursor);
+        qualifier = parse_name(&cursor, PARSER_CONTEXT_ROOT);
 
-        /* Validate the qualifier's opening */
-        error_check_qualifier_header(cursor);
+        /* Includes are a key and value at the top level, rather than
+         * a block. */
+        if(qualifier == QUALIFIER_INCLUDE) {
+            struct ParserInclude new_include;
 
-        /* What kind of qualifier are we handling? */
-        if((qualifier = enumerate_qualifier(&cursor)) == QUALIFIER_UNKNOWN) {
-            fprintf(stderr, "catalyst: unknown qualifier on line %i\n", cursor.line + 1);
-            exit(EXIT_FAILURE);
+            if(state->includes == NULL) {
+                libmatch_cursor_unwind(&cursor, (int) strlen("include: "));
+                parser_error(&cursor, "fragment files cannot include other files");
+            }
+
+            new_include.jobs = carray_length(state->jobs);
+            new_include.testcases = carray_length(state->testcases);
+            new_include.files = expand_include(&cursor, state, parse_string(&cursor, state));
+            end_of_value(&cursor);
+
+            carray_append(state->includes, new_include, INCLUDE);
+
+            continue;
         }
 
-        /* Jump to next line */
-        libmatch_next_line(&cursor);
+        /* Validate the qualifier's opening */
+        expect_character(&cursor, '{', "'{' after qualifier name");
+        expect_character(&cursor, '\n', "a new line after '{'");
 
         /* Decide which block to parse. */
         if(qualifier == QUALIFIER_TESTCASE) {
-            struct Testcase new_testcase = parse_testcase(&cursor, &state);
+            struct Testcase new_testcase = parse_testcase(&cursor, state);
 
-            carray_append(configuration.testcases, new_testcase, TESTCASE);
+            carray_append(state->testcases, new_testcase, TESTCASE);
         } else if(qualifier == QUALIFIER_JOB) {
-            struct Job new_job = parse_job(&cursor, &state);
+            struct Job new_job = parse_job(&cursor, state);
 
-            carray_append(configuration.jobs, new_job, JOB);
+            carray_append(state->jobs, new_job, JOB);
         }
-
-        /* Go past the '}\n' */
-        libmatch_cursor_getch(&cursor);
-        libmatch_cursor_getch(&cursor);
     }
+}
+
+/*
+ * The scratch arrays of the parser are reused for every value, and
+ * thrown away once the file is parsed.
+*/
+void init_parser_state(struct ParserState *state, const char *path, struct Arena *arena) {
+    INIT_VARIABLE(*state);
+
+    state->path = path;
+    state->arena = arena;
+    state->list = carray_init(state->list, CSTRING);
+    state->jobs = carray_init(state->jobs, JOB);
+    state->testcases = carray_init(state->testcases, TESTCASE);
+    state->argvs = carray_init(state->argvs, ARGV);
+    state->inputs = carray_init(state->inputs, CSTRING);
+    state->outputs = carray_init(state->outputs, CSTRING);
+    state->strings = chashmap_init(state->strings, INTERNED_STRING);
+    state->lists = chashmap_init(state->lists, INTERNED_LIST);
+    state->scratch = cstring_init("");
+
+    pthread_setspecific(parser_path_key, path);
+}
+
+void free_parser_state(struct ParserState *state) {
+    free(state->list->contents);
+    free(state->list);
+    free(state->jobs->contents);
+    free(state->jobs);
+    free(state->testcases->contents);
+    free(state->testcases);
+    free(state->argvs->contents);
+    free(state->argvs);
+    free(state->inputs->contents);
+    free(state->inputs);
+    free(state->outputs->contents);
+    free(state->outputs);
+    chashmap_free(state->strings, INTERNED_STRING);
+    chashmap_free(state->lists, INTERNED_LIST);
+    cstring_free(state->scratch);
+}
+
+/*
+ * Parse a fragment file into a configuration of its own.
+*/
+struct Configuration parse_fragment(const char *path) {
+    struct CString source;
+    struct ParserState state;
+    struct Configuration configuration;
 
-    cstring_free(state.line);
-    libmatch_cursor_free(&cursor);
+    INIT_VARIABLE(configuration);
+    init_parser_state(&state, path, &configuration.arena);
+
+    source = read_configuration(path);
+    parse_source(&state, source);
+    free(source.contents);
+
+    ADOPT_ARRAY(&configuration.arena, configuration.jobs, state.jobs, struct Job);
+    ADOPT_ARRAY(&configuration.arena, configuration.testcases, state.testcases, struct Testcase);
+    free_parser_state(&state);
 
     return configuration;
 }
 
 /*
+ * Each thread takes the next fragment that has not been parsed until
+ * there are none left. Every fragment has its own slot for its result,
+ * so the order they finish in does not matter.
+*/
+static void *parse_fragments(void *argument) {
+    struct ParserPool *pool = argument;
+
+    while(1) {
+        int index = 0;
+
+        pthread_mutex_lock(&pool->lock);
+        index = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+
+        if(index >= pool->length)
+            break;
+
+        pool->fragments[index] = parse_fragment(pool->files[index].path);
+    }
+
+    return NULL;
+}
+
+void parse_fragments_concurrently(struct ParserPool *pool) {
+    int index = 0;
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t *workers = NULL;
+
+    if(threads > pool->length)
+        threads = pool->length;
+
+    if(threads > PARSER_MAX_THREADS)
+        threads = PARSER_MAX_THREADS;
+
+    pthread_mutex_init(&pool->lock, NULL);
+
+    /* This thread is one of the workers too */
+    workers = malloc(sizeof(pthread_t) * (threads + 1));
+
+    for(index = 1; index < threads; index++) {
+        if((errno = pthread_create(workers + index, NULL, parse_fragments, pool)) != 0)
+            liberror_failure(parse_fragments_concurrently, pthread_create);
+    }
+
+    parse_fragments(pool);
+
+    for(index = 1; index < threads; index++) {
+        pthread_join(workers[index], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(workers);
+}
+
+/*
+ * Put the jobs and testcases of each fragment where its include
+ * directive was in the root file, and take ownership of the memory of
+ * the fragments.
+*/
+void merge_fragments(struct Configuration *configuration, struct ParserState *state,
+                     struct Configuration *fragments, int count) {
+    int index = 0;
+    int include_index = 0;
+    int fragment_index = 0;
+    int root_jobs = 0;
+    int root_testcases = 0;
+    struct Jobs *jobs = NULL;
+    struct Testcases *testcases = NULL;
+
+    /* The arrays of the fragments are copied into the arrays of the
+     * configuration, which are exactly the right size. */
+    jobs = arena_alloc(&configuration->arena, sizeof(*jobs));
+    testcases = arena_alloc(&configuration->arena, sizeof(*testcases));
+    jobs->capacity = carray_length(state->jobs);
+    testcases->capacity = carray_length(state->testcases);
+
+    for(index = 0; index < count; index++) {
+        jobs->capacity += carray_length(fragments[index].jobs);
+        testcases->capacity += carray_length(fragments[index].testcases);
+    }
+
+    jobs->contents = arena_alloc(&configuration->arena, sizeof(struct Job) * jobs->capacity);
+    testcases->contents = arena_alloc(&configuration->arena,
+                                      sizeof(struct Testcase) * testcases->capacity);
+
+    for(include_index = 0; include_index <= carray_length(state->includes); include_index++) {
+        int until_jobs = carray_length(state->jobs);
+        int until_testcases = carray_length(state->testcases);
+        struct ParserInclude include;
+
+        /* Everything in the root file after the last directive goes
+         * at the end. */
+        if(include_index < carray_length(state->includes)) {
+            include = state->includes->contents[include_index];
+            until_jobs = include.jobs;
+            until_testcases = include.testcases;
+        }
+
+        while(root_jobs < until_jobs)
+            jobs->contents[jobs->length++] = state->jobs->contents[root_jobs++];
+
+        while(root_testcases < until_testcases)
+            testcases->contents[testcases->length++] = state->testcases->contents[root_testcases++];
+
+        if(include_index == carray_length(state->includes))
+            break;
+
+        for(index = 0; index < include.files.length; index++, fragment_index++) {
+            struct Configuration fragment = fragments[fragment_index];
+
+            memcpy(jobs->contents + jobs->length, fragment.jobs->contents,
+                   sizeof(struct Job) * fragment.jobs->length);
+            memcpy(testcases->contents + testcases->length, fragment.testcases->contents,
+                   sizeof(struct Testcase) * fragment.testcases->length);
+            jobs->length += fragment.jobs->length;
+            testcases->length += fragment.testcases->length;
+
+            arena_adopt(&configuration->arena, &fragments[fragment_index].arena);
+        }
+    }
+
+    configuration->jobs = jobs;
+    configuration->testcases = testcases;
+}
+
+/*
+ * Make sure that no two testcases share a name, since a name is how a
+ * testcase is told apart in the results. Testcases without a name are
+ * not checked.
+*/
+void verify_testcase_names(struct Configuration configuration) {
+    int index = 0;
+    int location = 0;
+    struct TestcaseNames *names = NULL;
+
+    names = chashmap_init(names, TESTCASE_NAME);
 
-        printf("Character: '%c'\n", cursor.buffer[cursor.cursor]);
-        */
+    for(index = 0; index < carray_length(configuration.testcases); index++) {
+        struct Testcase *testcase = configuration.testcases->contents + index;
+
+        if(testcase->name.contents == NULL || testcase->name.length == 0)
+            continue;
+
+        chashmap_find(names, testcase, location, TESTCASE_NAME);
+
+        if(location != CHASHMAP_NOT_FOUND) {
+            fprintf(stderr, "catalyst: testcase name '%s' is used by more than one testcase\n",
+                    testcase->name.contents);
+            exit(EXIT_FAILURE);
+        }
+
+        chashmap_insert(names, testcase, TESTCASE_NAME);
+    }
+
+    chashmap_free(names, TESTCASE_NAME);
+}
+
+struct Configuration parse_configuration(const char *path) {
+    int index = 0;
+    struct CString source;
+    struct CString cache_path;
+    struct ParserPool pool;
+    struct ParserState state;
+    struct ConfigurationKey key;
+    struct Configuration configuration;
+
+    liberror_is_null(parse_configuration, path);
+
+    INIT_VARIABLE(pool);
+    INIT_VARIABLE(configuration);
+    pthread_once(&parser_path_once, create_parser_path_key);
+
+    /* Use the cached image of the configuration if the file has not
+     * changed since it was written. */
+    source = read_configuration(path);
+    key = configuration_key(path, source);
+    cache_path = cstring_init(path);
+    cstring_concats(&cache_path, CONFIGURATION_CACHE_SUFFIX);
+
+    if(load_configuration_cache(cache_path.contents, key, &configuration) == 1) {
+        cstring_free(cache_path);
+        free(source.contents);
+
+        return configuration;
+    }
+
+    /* Initialize stuff. Everything the configuration keeps comes from
+     * its arena, and the arrays are built up in reusable scratch arrays
+     * until they are finished. */
+    init_parser_state(&state, path, &configuration.arena);
+    state.includes = carray_init(state.includes, INCLUDE);
+
+    parse_source(&state, source);
+    free(source.contents);
+
+    /* Without includes, the configuration is just this file, and can be
+     * cached. The image would not notice a fragment changing, so a
+     * configuration with includes is not cached. */
+    if(carray_length(state.includes) == 0) {
+        ADOPT_ARRAY(&configuration.arena, configuration.jobs, state.jobs, struct Job);
+        ADOPT_ARRAY(&configuration.arena, configuration.testcases, state.testcases, struct Testcase);
+        verify_testcase_names(configuration);
+
+        store_configuration_cache(cache_path.contents, key, configuration);
+    } else {
+        for(index = 0; index < carray_length(state.includes); index++) {
+            pool.length += state.includes->contents[index].files.length;
+        }
+
+        /* Lay the fragments of every directive out in one array, in
+         * the order they will be merged in. */
+        pool.files = malloc(sizeof(struct LibpathFile) * (pool.length + 1));
+        pool.fragments = malloc(sizeof(struct Configuration) * (pool.length + 1));
+
+        for(index = 0; index < carray_length(state.includes); index++) {
+            struct LibpathFiles files = state.includes->contents[index].files;
+
+            memcpy(pool.files + pool.next, files.contents, sizeof(struct LibpathFile) * files.length);
+            pool.next += files.length;
+        }
+
+        pool.next = 0;
+        parse_fragments_concurrently(&pool);
+        pthread_setspecific(parser_path_key, path);
+        merge_fragments(&configuration, &state, pool.fragments, pool.length);
+        verify_testcase_names(configuration);
+
+        for(index = 0; index < carray_length(state.includes); index++) {
+            libpath_free_glob(state.includes->contents[index].files);
+        }
+
+        free(pool.files);
+        free(pool.fragments);
+    }
+
+    cstring_free(cache_path);
+    free(state.includes->contents);
+    free(state.includes);
+    free_parser_state(&state);
+
+    return configuration;
+}
@@ -45,27 +45,45 @@
 #define JOB_NAME        32 + 1
 #define MAKE_PATH       128 + 1
 
-#define QUALIFIER_NAME_LENGTH       32 + 1
-#define JOB_KEY_NAME_LENGTH         32 + 1
-#define TESTCASE_KEY_NAME_LENGTH    32 + 1
-#define NUMBER_LENGTH               32 + 1
 #define READ_BUFFER_LENGTH          12
+#define PARSER_DESCRIPTION_LENGTH   3
+#define PARSER_MAX_THREADS          64
 
 /* Enumerations */
 #define QUALIFIER_UNKNOWN   0
 #define QUALIFIER_JOB       1
 #define QUALIFIER_TESTCASE  2
+#define QUALIFIER_INCLUDE   3
 
 #define QUALIFIER_JOB_NAME          1
 #define QUALIFIER_JOB_MAKE          2
 #define QUALIFIER_JOB_ARGUMENTS     3
 
-#define QUALIFIER_TESTCASE_FILE         1
-#define QUALIFIER_TESTCASE_NAME         2
-#define QUALIFIER_TESTCASE_ARGV         3
-#define QUALIFIER_TESTCASE_STDOUT       4
-#define QUALIFIER_TESTCASE_STDIN        5
-#define QUALIFIER_TESTCASE_TIMEOUT      6
+#define QUALIFIER_TESTCASE_FILE                 1
+#define QUALIFIER_TESTCASE_NAME                 2
+#define QUALIFIER_TESTCASE_ARGV                 3
+#define QUALIFIER_TESTCASE_STDOUT               4
+#define QUALIFIER_TESTCASE_STDIN                5
+#define QUALIFIER_TESTCASE_TIMEOUT              6
+#define QUALIFIER_TESTCASE_SCRATCH              7
+#define QUALIFIER_TESTCASE_CPUS                 8
+#define QUALIFIER_TESTCASE_NICE                 9
+#define QUALIFIER_TESTCASE_IONICE               10
+#define QUALIFIER_TESTCASE_MAX_MEMORY           11
+#define QUALIFIER_TESTCASE_MAX_CPU_SECONDS      12
+#define QUALIFIER_TESTCASE_MAX_OPEN_FILES       13
+#define QUALIFIER_TESTCASE_MAX_OUTPUT_BYTES     14
+#define QUALIFIER_TESTCASE_MAX_WALL_MS          15
+#define QUALIFIER_TESTCASE_MAX_CPU_MS           16
+#define QUALIFIER_TESTCASE_MAX_RSS_KB           17
+#define QUALIFIER_TESTCASE_STDIN_FILE           18
+#define QUALIFIER_TESTCASE_FORKSERVER           19
+
+/* Limits of the scheduling keys of a testcase. A testcase without an
+ * ionice key keeps the I/O priority of catalyst. */
+#define TESTCASE_MAX_NICE       19
+#define TESTCASE_MAX_IONICE     7
+#define TESTCASE_NO_IONICE      -1
 
 /* Data structure properties */
 #define TESTCASE_TYPE   struct Testcase
@@ -74,33 +92,66 @@
 #define JOB_TYPE   struct Job
 #define JOB_HEAP   1
 
-#define HANDLE_EOF(_cursor)                                                                                    \
-do {                                                                                                           \
-    if((_cursor).cursor != (_cursor).length)                                                                   \
-        break;                                                                                                 \
-                                                                                                               \
-    fprintf(stderr, "catalyst: failed to parse configuration file-- expected character on line %i, got EOF"    \
-            " (%s:%i)\n", (_cursor).line + 1, __FILE__, __LINE__);                                             \
-    exit(EXIT_FAILURE);                                                                                        \
-} while(0)
-
-#define ASSERT_NEXT_CHARACTER(cursor, character)                                                              \
-do {                                                                                                          \
-    int __NEXT_CHARACTER = libmatch_cursor_getch(cursor);                                                     \
-                                                                                                              \
-    if(__NEXT_CHARACTER == (character))                                                                       \
-        break;                                                                                                \
-                                                                                                              \
-    if(character == LIBMATCH_EOF) {                                                                           \
-        fprintf(stderr, "catalyst: failed to parse configuration file-- expected '%c' on line %i, got EOF\n", \
-               (character), (cursor)->line + 1);                                                              \
-        exit(EXIT_FAILURE);                                                                                   \
-    }                                                                                                         \
-                                                                                                              \
-    fprintf(stderr, "catalyst: failed to parse configuration file-- expected '%c' on line %i, got '%c'\n",    \
-            (character), (cursor)->line + 1, __NEXT_CHARACTER);                                               \
-    exit(EXIT_FAILURE);                                                                                       \
-} while(0)
+#define ARGV_TYPE   struct CStrings *
+#define ARGV_HEAP   1
+
+#define INCLUDE_TYPE   struct ParserInclude
+#define INCLUDE_HEAP   1
+
+#define INTERNED_STRING_TYPE            struct CString
+#define INTERNED_STRING_HEAP            1
+#define INTERNED_STRING_FREE(value)
+#define INTERNED_STRING_HASH(value)     hash_bytes((value).contents, (value).length)
+#define INTERNED_STRING_COMPARE(a, b)   \
+    ((a).length == (b).length && memcmp((a).contents, (b).contents, (a).length) == 0)
+
+#define INTERNED_LIST_TYPE              struct CStrings *
+#define INTERNED_LIST_HEAP              1
+#define INTERNED_LIST_FREE(value)
+#define INTERNED_LIST_HASH(value)       hash_string_list(value)
+#define INTERNED_LIST_COMPARE(a, b)     compare_string_lists(a, b)
+
+#define TESTCASE_NAME_TYPE              struct Testcase *
+#define TESTCASE_NAME_HEAP              1
+#define TESTCASE_NAME_FREE(value)
+#define TESTCASE_NAME_HASH(value)       hash_bytes((value)->name.contents, (value)->name.length)
+#define TESTCASE_NAME_COMPARE(a, b)     \
+    ((a)->name.contents == (b)->name.contents || \
+     ((a)->name.length == (b)->name.length && memcmp((a)->name.contents, (b)->name.contents, (a)->name.length) == 0))
+
+/* Character classes, as bits in parser_character_classes */
+#define PARSER_CLASS_NAME_START     0x01
+#define PARSER_CLASS_NAME           0x02
+#define PARSER_CLASS_DIGIT          0x04
+#define PARSER_CLASS_WHITESPACE     0x08
+#define PARSER_CLASS_PRINTABLE      0x10
+
+#define PARSER_IS(character, class) \
+    ((parser_character_classes[(unsigned char) (character)] & (class)) != 0)
+
+#define PARSER_PEEK(_cursor) \
+    ((_cursor)->cursor == (_cursor)->length ? LIBMATCH_EOF : (unsigned char) (_cursor)->buffer[(_cursor)->cursor])
+
+/* Contexts that a name can appear in */
+#define PARSER_CONTEXT_ROOT         0
+#define PARSER_CONTEXT_JOB          1
+#define PARSER_CONTEXT_TESTCASE     2
+#define PARSER_CONTEXTS             3
+
+/* Perfect hash of every qualifier and key name. The multipliers must be
+ * chosen again whenever a name is added, so that every name still has a
+ * slot of its own in the table. */
+#define PARSER_KEY_TABLE_LENGTH     64
+#define PARSER_HASH_FIRST           1
+#define PARSER_HASH_SECOND          2
+#define PARSER_HASH_LAST            1
+#define PARSER_HASH_LENGTH          10
+
+#define PARSER_HASH(name, length)                                           \
+    ((((unsigned char) (name)[0]) * PARSER_HASH_FIRST +                     \
+      ((unsigned char) (name)[(length) > 1]) * PARSER_HASH_SECOND +         \
+      ((unsigned char) (name)[(length) - 1]) * PARSER_HASH_LAST +           \
+      (length) * PARSER_HASH_LENGTH) % PARSER_KEY_TABLE_LENGTH)
 
 /*
  * @docgen structure
@@ -124,6 +175,54 @@ do {
  *
  * @field timeout: the timeout for the program to end in milliseconds
  * @type: int
+ *
+ * @field scratch: whether the test runs in a scratch directory of its own
+ * @type: int
+ *
+ * @field stdin_file: whether the stdin of the test is a file rather than a pipe
+ * @type: int
+ *
+ * @field forkserver: whether the test is forked by a forkserver rather than executed
+ * @type: int
+ *
+ * @field cpus: the number of cpus the test is pinned to
+ * @type: int
+ *
+ * @field nice: the nice value the test runs at
+ * @type: int
+ *
+ * @field ionice: the best-effort I/O priority the test runs at, or TESTCASE_NO_IONICE
+ * @type: int
+ *
+ * @field max_memory: the bytes of address space the test can have, or 0
+ * @type: unsigned long
+ *
+ * @field max_cpu_seconds: the seconds of cpu time the test can use, or 0
+ * @type: unsigned int
+ *
+ * @field max_open_files: the files the test can have open at once, or 0
+ * @type: unsigned int
+ *
+ * @field max_output_bytes: the bytes the test can write, or 0
+ * @type: unsigned long
+ *
+ * @field max_wall_ms: the milliseconds the test should finish in, or 0
+ * @type: unsigned int
+ *
+ * @field max_cpu_ms: the milliseconds of cpu time the test should use, or 0
+ * @type: unsigned int
+ *
+ * @field max_rss_kb: the kilobytes the test should have resident at most, or 0
+ * @type: unsigned int
+ *
+ * @field argvs: every argv of a matrix testcase, or NULL
+ * @type: struct Argvs *
+ *
+ * @field inputs: every stdin of a matrix testcase, or NULL
+ * @type: struct CStrings *
+ *
+ * @field outputs: every stdout of a matrix testcase, or NULL
+ * @type: struct CStrings *
 */
 struct Testcase {
     struct CString path;
@@ -132,6 +231,52 @@ struct Testcase {
     struct CString input;
     struct CString output;
     int timeout;
+    int scratch;
+    int stdin_file;
+    int forkserver;
+    int cpus;
+    int nice;
+    int ionice;
+
+    /* Resource limits, which are not applied when they are 0 */
+    unsigned long max_memory;
+    unsigned int max_cpu_seconds;
+    unsigned int max_open_files;
+    unsigned long max_output_bytes;
+
+    /* Performance budgets, which fail a test that finished but went over
+     * them, and are not checked when they are 0 */
+    unsigned int max_wall_ms;
+    unsigned int max_cpu_ms;
+    unsigned int max_rss_kb;
+
+    /* Matrix axes. A key that is given more than once in a testcase
+     * becomes an axis, and the testcase is run once for every
+     * combination of them. The fields above hold the first entry of
+     * each axis. */
+    struct Argvs *argvs;
+    struct CStrings *inputs;
+    struct CStrings *outputs;
+};
+
+/*
+ * @docgen: structure
+ * @brief: array of argument lists
+ * @name: Argvs
+ *
+ * @field length: the length of the array
+ * @type: int
+ *
+ * @field capacity: the capacity of the array
+ * @type: int
+ *
+ * @field contents: the argument lists in the array
+ * @type: struct CStrings **
+*/
+struct Argvs {
+    int length;
+    int capacity;
+    struct CStrings **contents;
 };
 
 /*
@@ -154,6 +299,34 @@ struct Testcases {
     struct Testcase *contents;
 };
 
+/*
+ * @docgen: structure
+ * @brief: table of test cases by their name
+ * @name: TestcaseNames
+ *
+ * @field length: the number of test cases in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
+ * @type: int
+ *
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the test cases
+ * @type: struct Testcase **
+*/
+struct TestcaseNames {
+    int length;
+    int used;
+    int capacity;
+    unsigned char *states;
+    struct Testcase **contents;
+};
+
 /*
  * @docgen: structure
  * @brief: a make(1) job that catalyst executes
@@ -204,10 +377,162 @@ struct Jobs {
  *
  * @field testcases: the parsed testcases
  * @type: struct Testcases *
+ *
+ * @field arena: the arena that everything in the configuration is allocated from
+ * @type: struct Arena
+ *
+ * @field image: the mapped cache image, or NULL if it was parsed
+ * @type: char *
+ *
+ * @field image_length: the length of the mapped cache image
+ * @type: long
 */
 struct Configuration {
     struct Jobs *jobs;
     struct Testcases *testcases;
+    struct Arena arena;
+
+    /* Set when loaded from a cache image */
+    char *image;
+    long image_length;
+};
+
+/*
+ * @docgen: structure
+ * @brief: identifies the contents of a configuration file
+ * @name: ConfigurationKey
+ *
+ * @field size: the size of the file in bytes
+ * @type: unsigned long
+ *
+ * @field mtime: the modification time of the file
+ * @type: unsigned long
+ *
+ * @field hash: a hash of the contents of the file
+ * @type: unsigned long
+*/
+struct ConfigurationKey {
+    unsigned long size;
+    unsigned long mtime;
+    unsigned long hash;
+};
+
+/*
+ * @docgen: structure
+ * @brief: a name that the parser recognizes
+ * @name: ParserKey
+ *
+ * @field name: the name, or NULL for an empty slot
+ * @type: const char *
+ *
+ * @field length: the length of the name
+ * @type: int
+ *
+ * @field values: the enumeration of the name in each context
+ * @type: int [PARSER_CONTEXTS]
+*/
+struct ParserKey {
+    const char *name;
+    int length;
+    int values[PARSER_CONTEXTS];
+};
+
+extern const unsigned char parser_character_classes[256];
+
+/*
+ * @docgen: structure
+ * @brief: an include directive in the root configuration file
+ * @name: ParserInclude
+ *
+ * @field jobs: the number of jobs in the root file before the directive
+ * @type: int
+ *
+ * @field testcases: the number of testcases in the root file before the directive
+ * @type: int
+ *
+ * @field files: the fragment files that the pattern matched, sorted by path
+ * @type: struct LibpathFiles
+*/
+struct ParserInclude {
+    int jobs;
+    int testcases;
+    struct LibpathFiles files;
+};
+
+/*
+ * @docgen: structure
+ * @brief: array of include directives
+ * @name: ParserIncludes
+ *
+ * @field length: the length of the array
+ * @type: int
+ *
+ * @field capacity: the capacity of the array
+ * @type: int
+ *
+ * @field contents: the include directives in the array
+ * @type: struct ParserInclude *
+*/
+struct ParserIncludes {
+    int length;
+    int capacity;
+    struct ParserInclude *contents;
+};
+
+/*
+ * @docgen: structure
+ * @brief: table of the strings interned by the parser
+ * @name: ParserStrings
+ *
+ * @field length: the number of strings in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
+ * @type: int
+ *
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the strings
+ * @type: struct CString *
+*/
+struct ParserStrings {
+    int length;
+    int used;
+    int capacity;
+    unsigned char *states;
+    struct CString *contents;
+};
+
+/*
+ * @docgen: structure
+ * @brief: table of the arrays of strings interned by the parser
+ * @name: ParserLists
+ *
+ * @field length: the number of arrays in the table
+ * @type: int
+ *
+ * @field used: the number of slots in use, including removed ones
+ * @type: int
+ *
+ * @field capacity: the number of slots in the table
+ * @type: int
+ *
+ * @field states: the state of each slot
+ * @type: unsigned char *
+ *
+ * @field contents: the arrays
+ * @type: struct CStrings **
+*/
+struct ParserLists {
+    int length;
+    int used;
+    int capacity;
+    unsigned char *states;
+    struct CStrings **contents;
 };
 
 /*
@@ -215,11 +540,55 @@ struct Configuration {
  * @brief: data that the parser uses in the parsing process.
  * @name: ParserState
  *
- * @field line: a line buffer that is reused in parsing
+ * @field path: the path to the file being parsed
+ * @type: const char *
+ *
+ * @field arena: the arena to allocate the configuration from
+ * @type: struct Arena *
+ *
+ * @field list: a list of strings that is reused in parsing
+ * @type: struct CStrings *
+ *
+ * @field jobs: the jobs parsed so far
+ * @type: struct Jobs *
+ *
+ * @field testcases: the testcases parsed so far
+ * @type: struct Testcases *
+ *
+ * @field argvs: the argument lists of the testcase being parsed
+ * @type: struct Argvs *
+ *
+ * @field inputs: the stdins of the testcase being parsed
+ * @type: struct CStrings *
+ *
+ * @field outputs: the stdouts of the testcase being parsed
+ * @type: struct CStrings *
+ *
+ * @field includes: the include directives parsed so far, or NULL in a fragment
+ * @type: struct ParserIncludes *
+ *
+ * @field strings: the strings interned so far
+ * @type: struct ParserStrings *
+ *
+ * @field lists: the arrays of strings interned so far
+ * @type: struct ParserLists *
+ *
+ * @field scratch: a buffer that strings are unescaped into
  * @type: struct CString
 */
 struct ParserState {
-    struct CString line;
+    const char *path;
+    struct Arena *arena;
+    struct CStrings *list;
+    struct Jobs *jobs;
+    struct Testcases *testcases;
+    struct Argvs *argvs;
+    struct CStrings *inputs;
+    struct CStrings *outputs;
+    struct ParserIncludes *includes;
+    struct ParserStrings *strings;
+    struct ParserLists *lists;
+    struct CString scratch;
 };
 
 /*
@@ -234,6 +603,17 @@ struct ParserState {
  * @to it, and extract all the testcases inside of it, and
  * @all of the jobs that are defined in the configuration
  * @file.
+ * @
+ * @The configuration file can include fragment files with
+ * @
+ * @include: "suites/unit_*.catalyst"
+ * @
+ * @where the pattern is relative to the directory of the
+ * @configuration file, and only its file name can contain a
+ * @wildcard. The fragments are parsed concurrently, and their
+ * @jobs and testcases take the place of the directive in the
+ * @order of the configuration, with the fragments sorted by
+ * @path. Fragments cannot include other files.
  * @description
  *
  * @error: path is NULL
@@ -246,6 +626,74 @@ struct ParserState {
 */
 struct Configuration parse_configuration(const char *path);
 
+/*
+ * @docgen: function
+ * @brief: report a syntax error in the configuration file
+ * @name: parser_error
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function will print an error message formatted like printf(3)
+ * @would, followed by the line and column of the cursor, and then exit
+ * @the program.
+ * @description
+ *
+ * @param cursor: the cursor the error was found at
+ * @type: struct LibmatchCursor *
+ *
+ * @param format: the format of the message
+ * @type: const char *
+*/
+void parser_error(struct LibmatchCursor *cursor, const char *format, ...);
+
+/*
+ * @docgen: function
+ * @brief: describe a character for an error message
+ * @name: describe_character
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function will produce a human readable description of a
+ * @character for use in an error message, using buffer to hold
+ * @it if the description is not a constant.
+ * @description
+ *
+ * @param character: the character to describe, or LIBMATCH_EOF
+ * @type: int
+ *
+ * @param buffer: a buffer to hold the description
+ * @type: char [PARSER_DESCRIPTION_LENGTH + 1]
+ *
+ * @return: the description of the character
+ * @type: const char *
+*/
+const char *describe_character(int character, char buffer[PARSER_DESCRIPTION_LENGTH + 1]);
+
+/*
+ * @docgen: function
+ * @brief: consume a character that must come next
+ * @name: expect_character
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function will consume the next character in the cursor, and
+ * @raise an error describing what was expected if it is not character.
+ * @description
+ *
+ * @param cursor: the cursor to use
+ * @type: struct LibmatchCursor *
+ *
+ * @param character: the character that must come next
+ * @type: int
+ *
+ * @param expected: a description of the character for the error
+ * @type: const char *
+*/
+void expect_character(struct LibmatchCursor *cursor, int character, const char *expected);
+
 /*
  * @docgen: function
  * @brief: parse an integer from a value
@@ -268,6 +716,52 @@ struct Configuration parse_configuration(const char *path);
 */
 unsigned int parse_uinteger(struct LibmatchCursor *cursor);
 
+/*
+ * @docgen: function
+ * @brief: parse an integer that fits in an int from a value
+ * @name: parse_integer
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function, with the cursor on the first digit of a number,
+ * @parse the number into a non-negative int, for values that are kept
+ * @in an int. A number bigger than INT_MAX is a parser error.
+ * @description
+ *
+ * @error: cursor is NULL
+ *
+ * @param cursor: the cursor to use
+ * @type: struct LibmatchCursor *
+ *
+ * @return: the parsed integer
+ * @type: int
+*/
+int parse_integer(struct LibmatchCursor *cursor);
+
+/*
+ * @docgen: function
+ * @brief: parse a long integer from a value
+ * @name: parse_ulong
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function, with the cursor on the first digit of a number,
+ * @parse the number into an unsigned long, for values like sizes in
+ * @bytes that can be too big for an unsigned integer.
+ * @description
+ *
+ * @error: cursor is NULL
+ *
+ * @param cursor: the cursor to use
+ * @type: struct LibmatchCursor *
+ *
+ * @return: the parsed integer
+ * @type: unsigned long
+*/
+unsigned long parse_ulong(struct LibmatchCursor *cursor);
+
 /*
  * @docgen: function
  * @brief: parse a string from a value
@@ -279,17 +773,28 @@ unsigned int parse_uinteger(struct LibmatchCursor *cursor);
  * @This function, with the cursor on the opening quote of a string, will
  * @parse the string into a usable cstring object. This will interpret
  * @basic escape sequences.
+ * @
+ * @Escape sequences are unescaped into the scratch buffer of the parser,
+ * @and the cursor's buffer is left alone. The string is then interned:
+ * @the first appearance of a string is copied into the parser's arena,
+ * @and later appearances return that copy. So, two strings from the same
+ * @file are equal if their contents pointers are, and the cursor's buffer
+ * @is not needed once parsing is done.
  * @description
  *
  * @error: cursor is NULL
+ * @error: state is NULL
  *
  * @param cursor: the cursor to use
  * @type: struct LibmatchCursor *
  *
+ * @param state: the state of the parser
+ * @type: struct ParserState *
+ *
  * @return: the parsed cstring
  * @type: struct CString
 */
-struct CString parse_string(struct LibmatchCursor *cursor);
+struct CString parse_string(struct LibmatchCursor *cursor, struct ParserState *state);
 
 /*
  * @docgen: function
@@ -300,18 +805,176 @@ struct CString parse_string(struct LibmatchCursor *cursor);
  *
  * @description
  * @This function, with the cursor on the opening quote of the first
- * @string, will begin parsing an array of strings.
+ * @string, will begin parsing an array of strings. The array is
+ * @allocated from the parser's arena. Like strings, arrays are interned,
+ * @so an array that already appeared in the file is returned again
+ * @rather than allocated again.
  * @description
  *
  * @error: cursor is NULL
+ * @error: state is NULL
  *
  * @param cursor: the cursor to use
  * @type: struct LibmatchCursor *
  *
+ * @param state: the state of the parser
+ * @type: struct ParserState *
+ *
  * @return: the parsed array of cstrings
  * @type: struct CStrings
 */
-struct CStrings *parse_string_list(struct LibmatchCursor *cursor);
+struct CStrings *parse_string_list(struct LibmatchCursor *cursor, struct ParserState *state);
+
+/*
+ * @docgen: function
+ * @brief: hash an interned array of strings
+ * @name: hash_string_list
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @Hashes an array of interned strings by the contents pointers of its
+ * @strings.
+ * @description
+ *
+ * @param list: the array to hash
+ * @type: struct CStrings *
+ *
+ * @return: the hash of the array
+ * @type: unsigned long
+*/
+unsigned long hash_string_list(struct CStrings *list);
+
+/*
+ * @docgen: function
+ * @brief: compare two interned arrays of strings
+ * @name: compare_string_lists
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @Determines whether two arrays of interned strings are equal, which
+ * @they are if they have the same strings by pointer, in the same order.
+ * @description
+ *
+ * @param a: the first array
+ * @type: struct CStrings *
+ *
+ * @param b: the second array
+ * @type: struct CStrings *
+ *
+ * @return: 1 if the arrays are equal, 0 if they are not
+ * @type: int
+*/
+int compare_string_lists(struct CStrings *a, struct CStrings *b);
+
+/*
+ * @docgen: function
+ * @brief: compute the cache key of a configuration file
+ * @name: configuration_key
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function will produce the key that a cached image of the
+ * @configuration file at path is stored under. The key is made up of
+ * @the size and modification time of the file, and a hash of source,
+ * @which should be the contents of the file.
+ * @description
+ *
+ * @error: path is NULL
+ * @error: source.contents is NULL
+ *
+ * @param path: the path to the configuration file
+ * @type: const char *
+ *
+ * @param source: the contents of the configuration file
+ * @type: struct CString
+ *
+ * @return: the key of the configuration file
+ * @type: struct ConfigurationKey
+*/
+struct ConfigurationKey configuration_key(const char *path, struct CString source);
+
+/*
+ * @docgen: function
+ * @brief: load a cached configuration image
+ * @name: load_configuration_cache
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function will map the cache image at path into memory, and
+ * @relocate it so that it can be used in place as a configuration. The
+ * @image is only used if it was written for a configuration file with
+ * @the same key, and by a build of catalyst with the same layout of
+ * @the configuration structures.
+ * @description
+ *
+ * @error: path is NULL
+ * @error: configuration is NULL
+ *
+ * @param path: the path to the cache image
+ * @type: const char *
+ *
+ * @param key: the key of the configuration file
+ * @type: struct ConfigurationKey
+ *
+ * @param configuration: the configuration to load into
+ * @type: struct Configuration *
+ *
+ * @return: 1 if the image was loaded, 0 if there is no usable image
+ * @type: int
+*/
+int load_configuration_cache(const char *path, struct ConfigurationKey key,
+                             struct Configuration *configuration);
+
+/*
+ * @docgen: function
+ * @brief: write a configuration to a cache image
+ * @name: store_configuration_cache
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @This function will write a relocatable image of a parsed configuration
+ * @to path, so that load_configuration_cache can skip parsing the file
+ * @the next time catalyst runs. The image is written to a temporary file
+ * @first, and renamed into place. Failing to write the image is not an
+ * @error, as the cache is only an optimization.
+ * @description
+ *
+ * @error: path is NULL
+ *
+ * @param path: the path to write the cache image to
+ * @type: const char *
+ *
+ * @param key: the key of the configuration file
+ * @type: struct ConfigurationKey
+ *
+ * @param configuration: the configuration to store
+ * @type: struct Configuration
+*/
+void store_configuration_cache(const char *path, struct ConfigurationKey key,
+                               struct Configuration configuration);
+
+/*
+ * @docgen: function
+ * @brief: release a configuration loaded from a cache image
+ * @name: free_configuration_cache
+ *
+ * @include: parsers.h
+ *
+ * @description
+ * @Unmaps the cache image that a configuration was loaded from. Every
+ * @structure and string in the configuration lives inside of the image,
+ * @so nothing else needs to be released.
+ * @description
+ *
+ * @param configuration: the configuration to release
+ * @type: struct Configuration
+*/
+void free_configuration_cache(struct Configuration configuration);
 
 #endif
 
@@ -40,197 +40,250 @@
  * values to keys inside of qualifiers.
 */
 
-#include <math.h>
-#include <ctype.h>
+#include <limits.h>
+#include <string.h>
 
 #include "../catalyst.h"
+#include "../common/common.h"
 #include "parsers.h"
 
-#define ADDCH_AND_CONCAT(character)             \
-    if(cursor == READ_BUFFER_LENGTH) {          \
-        cstring_concats(&new_cstring, buffer);  \
-                                                \
-        buffer[0] = '\0';                       \
-    }
-
 /*
- * @docgen: function
- * @brief: validate the syntax of an (unsigned) integer
- * @name: error_uinteger
- *
- * @description
- * @This functiion will verify that an unsigned integer does not contain
- * @any illegal characters. Unsigned numbers should only contain numeric
- * @characters, and scientific notation (xEy) is also forbidden.
- * @description
- *
- * @param cursor: the cursor to do error checking on
- * @type: struct LibmatchCursor
+ * Parse the digits of a number that can be no bigger than maximum
 */
-void error_uinteger(struct LibmatchCursor cursor) {
+static unsigned long parse_digits(struct LibmatchCursor *cursor, unsigned long maximum) {
     int character = 0;
+    unsigned long number = 0;
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
+
+    /* Unsigned numbers should only contain numeric characters, and
+     * scientific notation (xEy) is also forbidden. The number ends at
+     * the end of the line. */
+    while((character = PARSER_PEEK(cursor)) != '\n') {
+        if(character == LIBMATCH_EOF || PARSER_IS(character, PARSER_CLASS_DIGIT) == 0) {
+            parser_error(cursor, "expected a digit in unsigned integer, got %s",
+                         describe_character(character, description));
+        }
+
+        if(number > (maximum - (unsigned long) (character - '0')) / 10)
+            parser_error(cursor, "unsigned integer is too big");
 
-    while((character = libmatch_cursor_getch(&cursor)) != '\n') {
-        HANDLE_EOF(cursor);
+        number = (number * 10) + (unsigned long) (character - '0');
+        libmatch_cursor_getch(cursor);
     }
+
+    return number;
+}
+
+unsigned int parse_uinteger(struct LibmatchCursor *cursor) {
+    liberror_is_null(parse_uinteger, cursor);
+
+    return (unsigned int) parse_digits(cursor, UINT_MAX);
+}
+
+int parse_integer(struct LibmatchCursor *cursor) {
+    liberror_is_null(parse_integer, cursor);
+
+    return (int) parse_digits(cursor, INT_MAX);
+}
+
+unsigned long parse_ulong(struct LibmatchCursor *cursor) {
+    liberror_is_null(parse_ulong, cursor);
+
+    return parse_digits(cursor, ULONG_MAX);
 }
 
 /*
- * @docgen: function
- * @brief: determine whether or not to continue reading a list
- * @name: continue_list
- *
- * @description
- * @This function will determine whether or not to continue reading a
- * @list of strings based off whether or not the current character,
- * @and the next character is a comma (,) and space ( ) respectively.
- * @description
- *
- * @param cursor: the cursor to use
- * @type: struct LibmatchCursor
- *
- * @return: 1 if list parsing should continue and 0 to stop
- * @type: int
+ * Interpret the character after a backslash in a string, or -1 if it
+ * does not make an escape sequence.
 */
-int continue_list(struct LibmatchCursor cursor) {
-    int character_a = 0;
-    int character_b = 0;
+static int escaped_character(int character) {
+    switch(character) {
+        case 'n':
+            return '\n';
+        case 'v':
+            return '\v';
+        case 't':
+            return '\t';
+        case '"':
+        case '\\':
+            return character;
+    }
+
+    return -1;
+}
 
-    character_a = libmatch_cursor_getch(&cursor);
-    HANDLE_EOF(cursor);
+static int unescape_character(struct LibmatchCursor *cursor, int character) {
+    char description[PARSER_DESCRIPTION_LENGTH + 1] = "";
 
-    character_b = libmatch_cursor_getch(&cursor);
-    HANDLE_EOF(cursor);
+    if(escaped_character(character) != -1)
+        return escaped_character(character);
 
-    if(character_a == ',' && character_b == ' ')
-        return 1;
+    parser_error(cursor, "unknown escape sequence in string, got %s after '\\'",
+                 describe_character(character, description));
 
-    if(character_a == '\n')
-        return 0;
-    
-    fprintf(stderr, "catalyst: list on line %i expected ', ' before next element, got"
-            " %c%c\n", cursor.line + 1, character_a, character_b);
-    exit(EXIT_FAILURE);
+    return 0;
 }
 
-unsigned int parse_uinteger(struct LibmatchCursor *cursor) {
-    int index = 0;
-    int length = 0;
-    unsigned int number = 0;
-    char number_ascii[NUMBER_LENGTH + 1] = "";
+/*
+ * Identical strings are kept once per file, so that they take up no more
+ * memory than the first of them, and so that they can be compared by
+ * their contents pointer. The string is a view into the source of the
+ * file or the scratch buffer, so the first of them is copied into the
+ * arena. The copy belongs to the arena, and has no capacity of its own
+ * to grow into.
+*/
+static struct CString intern_string(struct ParserState *state, struct CString cstring) {
+    int location = 0;
+    struct CString interned;
 
-    liberror_is_null(parse_integer, cursor);
-    error_uinteger(*cursor);
+    chashmap_find(state->strings, cstring, location, INTERNED_STRING);
+
+    if(location != CHASHMAP_NOT_FOUND)
+        return state->strings->contents[location];
+
+    interned.length = cstring.length;
+    interned.capacity = 0;
+    interned.contents = arena_alloc(state->arena, cstring.length + 1);
+    memcpy(interned.contents, cstring.contents, cstring.length);
+
+    chashmap_insert(state->strings, interned, INTERNED_STRING);
+
+    return interned;
+}
+
+unsigned long hash_string_list(struct CStrings *list) {
+    int index = 0;
+    unsigned long hash = (unsigned long) list->length;
 
-    /* Read the number and verify it is not too big */
-    if((length = libmatch_read_until(cursor, number_ascii, NUMBER_LENGTH, "\n")) >= NUMBER_LENGTH) {
-        fprintf(stderr, "catalyst: value in key/value pair on line %i is too big\n", cursor->line + 1);
-        exit(EXIT_FAILURE);
+    /* The strings are interned, so they are equal if their pointers are */
+    for(index = 0; index < list->length; index++) {
+        hash = (hash * 31) ^ (unsigned long) list->contents[index].contents;
     }
 
-    /* Scan the number, and convert it into an actual number and verify it
-     * along the way */
-    for(index = 0; number_ascii[index] != '\0'; index++) {
-        int base = length - index - 1;
-        int digit = number_ascii[index];
+    return hash ^ (hash >> 16);
+}
+
+int compare_string_lists(struct CStrings *a, struct CStrings *b) {
+    int index = 0;
 
-        if(isdigit(digit) == 0) {
-            fprintf(stderr, "catalyst: invalid character '%c' on line %i\n", digit, cursor->line + 1);
-            exit(EXIT_FAILURE);
-        }
+    if(a->length != b->length)
+        return 0;
 
-        number = number + (digit - 48) * ((int) (pow(10, base)));
+    for(index = 0; index < a->length; index++) {
+        if(a->contents[index].contents != b->contents[index].contents)
+            return 0;
     }
 
-    return number;
+    return 1;
 }
 
-struct CString parse_string(struct LibmatchCursor *cursor) {
-    int character = libmatch_cursor_getch(cursor);
-    struct CString new_cstring = cstring_init("");
+struct CString parse_string(struct LibmatchCursor *cursor, struct ParserState *state) {
+    int index = 0;
+    int start = 0;
+    int position = 0;
+    int escapes = 0;
+    struct LibmatchSet stops;
+    struct CString new_cstring;
 
-    HANDLE_EOF(*cursor);
+    liberror_is_null(parse_string, cursor);
+    liberror_is_null(parse_string, state);
 
     /* Value is missing an opening quote (0x22) */
-    if(character != '"') {
-        fprintf(stderr, "catalyst: expected start of value on line %i to be a '\"', got '%c'\n",
-                cursor->line + 1, character);
-        exit(EXIT_FAILURE);
-    }
+    expect_character(cursor, '"', "start of string to be a '\"'");
+    start = cursor->cursor;
+    libmatch_set_init(&stops, "\"\\");
+
+    /* Find the closing quote, and how many escape sequences there are
+     * on the way to it. Everything between them is skipped in bulk, and
+     * the cursor only catches up once the string is over. */
+    for(position = start; 1; position += 2) {
+        position += libmatch_scan(cursor->buffer + position, cursor->length - position, &stops);
+
+        if(position < cursor->length && cursor->buffer[position] == '"')
+            break;
+
+        if(position + 1 >= cursor->length) {
+            libmatch_cursor_advance(cursor, cursor->length - cursor->cursor);
+            parser_error(cursor, "expected '\"' to close string, got EOF");
+        }
 
-    /* Keep reading segments of the string until an unescaped " is
-     * reached. */
-    while(cursor->buffer[cursor->cursor] != '"') {
-        int index = 0;
-        int escaped = 0;
-        char buffer[READ_BUFFER_LENGTH + 1] = "";
-
-        /* Read until the buffer is full */
-        while(index < READ_BUFFER_LENGTH && cursor->buffer[cursor->cursor] != '"') {
-            character = libmatch_cursor_getch(cursor);
-
-            HANDLE_EOF(*cursor);
-
-            if(escaped == 0 && character == '\\') {
-                escaped = 1;
-
-                continue;
-            }
-
-            /* Interpret this character as the escaped form */
-            if(escaped == 1) {
-                switch(character) {
-                    case 'n':
-                        buffer[index] = '\n';
-                        break;
-                    case 'v':
-                        buffer[index] = '\v';
-                        break;
-                    case 't':
-                        buffer[index] = '\t';
-                        break;
-                }
-            } else {
-                buffer[index] = character;
-            }
-
-            index++;
-            escaped = 0;
+        if(escaped_character(cursor->buffer[position + 1]) == -1) {
+            libmatch_cursor_advance(cursor, position + 1 - cursor->cursor);
+            unescape_character(cursor, libmatch_cursor_getch(cursor));
         }
 
-        buffer[index] = '\0';
-        cstring_concats(&new_cstring, buffer);
+        escapes++;
     }
 
-    /* Go past the quote */
-    libmatch_cursor_getch(cursor);
+    libmatch_cursor_advance(cursor, position + 1 - cursor->cursor);
 
-    return new_cstring;
-}
+    new_cstring.length = cursor->cursor - start - 1 - escapes;
+    new_cstring.capacity = 0;
+    new_cstring.contents = cursor->buffer + start;
 
-struct CStrings *parse_string_list(struct LibmatchCursor *cursor) {
-    struct CStrings *cstring_list = carray_init(cstring_list, CSTRING);
+    if(escapes == 0)
+        return intern_string(state, new_cstring);
 
-    while(cursor->cursor < cursor->length) {
-        struct CString next_string = parse_string(cursor);
+    /* The file has to stay as it is for error messages, so the string
+     * is unescaped into a scratch buffer, a run of plain text at a time. */
+    cstring_reserve(&state->scratch, new_cstring.length);
 
-        carray_append(cstring_list, next_string, CSTRING);
+    for(position = start; escapes > 0; escapes--) {
+        int span = (int) ((char *) memchr(cursor->buffer + position, '\\', cursor->cursor - position) -
+                          (cursor->buffer + position));
 
-        if(continue_list(*cursor) == 0)
-            break;
+        memcpy(state->scratch.contents + index, cursor->buffer + position, span);
+        index += span;
+        position += span + 1;
 
-        /* Go past the ', ' */
-        libmatch_cursor_getch(cursor);
-        libmatch_cursor_getch(cursor);
+        state->scratch.contents[index] = (char) escaped_character(cursor->buffer[position]);
+        index++;
+        position++;
     }
 
-    return cstring_list;
+    memcpy(state->scratch.contents + index, cursor->buffer + position, new_cstring.length - index);
+    new_cstring.contents = state->scratch.contents;
+
+    return intern_string(state, new_cstring);
 }
 
+struct CStrings *parse_string_list(struct LibmatchCursor *cursor, struct ParserState *state) {
+    int location = 0;
+    struct CStrings *cstring_list = NULL;
 
+    liberror_is_null(parse_string_list, cursor);
+    liberror_is_null(parse_string_list, state);
 
+    state->list->length = 0;
 
+    /* Elements are separated by ', ', and the list ends at the end
+     * of the line. */
+    while(1) {
+        struct CString next_string = parse_string(cursor, state);
 
+        carray_append(state->list, next_string, CSTRING);
 
+        if(PARSER_PEEK(cursor) != ',')
+            break;
 
+        libmatch_cursor_getch(cursor);
+        expect_character(cursor, ' ', "a space after ',' in list");
+    }
+
+    /* Argument lists repeat just as often as the strings in them */
+    chashmap_find(state->lists, state->list, location, INTERNED_LIST);
+
+    if(location != CHASHMAP_NOT_FOUND)
+        return state->lists->contents[location];
+
+    /* The list is finished, so it can be given its exact size */
+    cstring_list = arena_alloc(state->arena, sizeof(*cstring_list));
+    cstring_list->length = state->list->length;
+    cstring_list->capacity = state->list->length;
+    cstring_list->contents = arena_alloc(state->arena, sizeof(struct CString) * state->list->length);
+    memcpy(cstring_list->contents, state->list->contents, sizeof(struct CString) * state->list->length);
 
+    chashmap_insert(state->lists, cstring_list, INTERNED_LIST);
+
+    return cstring_list;
+}
@@ -39,18 +39,26 @@
  * This file has routines for executing a testcase.
 */
 
-#define _POSIX_C_SOURCE 1
+/* prlimit is only declared for GNU code */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 200112L
+#endif
 
 #include <poll.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <time.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 
 #include "testing.h"
 #include "../catalyst.h"
 #include "../jobs/jobs.h"
+#include "../common/common.h"
 #include "../parsers/parsers.h"
 
 static const char *timeout_failure =
@@ -64,54 +72,133 @@ static const char *abortion_failure =
 static const char *abortion_failure_no_output =
     "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' aborted\n";
 
+static const char *output_failure =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' wrote more than "
+    "%lu bytes of output\n";
+
+static const char *cpu_failure =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' used more than "
+    "%lu seconds of cpu time\n";
+
+static const char *memory_failure =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' crashed while "
+    "limited to %lu bytes of memory\n";
+
+static const char *wall_budget_failure =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' took %lu "
+    "milliseconds, over its budget of %lu\n";
+
+static const char *cpu_budget_failure =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' used %lu "
+    "milliseconds of cpu time, over its budget of %lu\n";
+
+static const char *rss_budget_failure =
+    "[ \x1B[31mFAILURE\x1B[0m ] testcase '%s' for test '%s' had %lu "
+    "kilobytes resident, over its budget of %lu\n";
+
+static const char *stray_processes =
+    "[ \x1B[33mWARNING\x1B[0m ] testcase '%s' for test '%s' left processes "
+    "running after it exited\n";
+
 static const char *successful =
     "[ \x1b[32mSUCCESS\x1B[0m ] testcase '%s' for '%s' finished successfully\n";
 
-int fd_is_readable(int fd) {
-    struct pollfd descriptors[1];
+/*
+ * A limit of 0 is no limit. A limit cannot be raised past the hard limit
+ * that catalyst was given, so it is held to that instead. The limits of
+ * a test that was forked by a forkserver are set from its runner.
+*/
+static void apply_limit(int pid, int resource, unsigned long limit, unsigned long grace) {
+    struct rlimit current;
+
+    if(limit == 0)
+        return;
 
-    INIT_VARIABLE(descriptors);
-    descriptors[0].fd = fd;
-    descriptors[0].events = POLLIN;
+#if defined(__linux__)
+    if(prlimit(pid, resource, NULL, &current) == -1)
+        liberror_failure(apply_limit, prlimit);
+#else
+    if(getrlimit(resource, &current) == -1)
+        liberror_failure(apply_limit, getrlimit);
+#endif
 
-    /* Timeout of 500 milliseconds is kind of arbitrary, honestly. That
-     * being said, may be better to implement something in libproc for this
-     * kind of thing (portable fd checking). */
-    switch(poll(descriptors, 1, 500)) {
-        case -1:
-            liberror_failure(fd_is_readable, poll);
+    current.rlim_cur = (rlim_t) limit;
 
-            break;
-        case 0:
-            return 0;
+    if(current.rlim_max == RLIM_INFINITY || current.rlim_max > (rlim_t) (limit + grace))
+        current.rlim_max = (rlim_t) (limit + grace);
+
+    if(current.rlim_cur > current.rlim_max)
+        current.rlim_cur = current.rlim_max;
+
+#if defined(__linux__)
+    if(prlimit(pid, resource, &current, NULL) == -1)
+        liberror_failure(apply_limit, prlimit);
+#else
+    if(setrlimit(resource, &current) == -1)
+        liberror_failure(apply_limit, setrlimit);
+#endif
+}
+
+/*
+ * The cpu limit is one second short of the hard limit, so that the test
+ * is sent SIGXCPU before it is killed, and the runner can tell the two
+ * apart from the other ways for a test to die. Output to files counts
+ * towards the output limit, and SIGXFSZ is sent to a test that writes
+ * past it.
+*/
+static void apply_limits(struct Testcase testcase, int pid) {
+    apply_limit(pid, RLIMIT_AS, testcase.max_memory, 0);
+    apply_limit(pid, RLIMIT_CPU, testcase.max_cpu_seconds, 1);
+    apply_limit(pid, RLIMIT_NOFILE, testcase.max_open_files, 0);
+    apply_limit(pid, RLIMIT_FSIZE, testcase.max_output_bytes, 0);
+}
+
+/*
+ * The path to a test, which has to be found from the directory that
+ * catalyst was started in when the test runs in a scratch directory.
+*/
+static struct CString testcase_path(struct Testcase testcase, const char *scratch) {
+    struct CString test_path = cstring_init("");
+    char directory[LIBPATH_MAX_PATH + 1] = "";
+
+    if(scratch != NULL && getcwd(directory, LIBPATH_MAX_PATH) != NULL) {
+        cstring_concats(&test_path, directory);
+        cstring_concats(&test_path, LIBPATH_SEPARATOR);
     }
 
-    return 1;
+    cstring_concats(&test_path, TESTS_DIRECTORY);
+    cstring_concats(&test_path, LIBPATH_SEPARATOR);
+    cstring_concat(&test_path, testcase.path);
+
+    return test_path;
 }
 
-void testcase_fork(struct Testcase testcase, int parent_to_child[2], int child_to_parent[2]) {
+void testcase_fork(struct Testcase testcase, int parent_to_child[2], int child_to_parent[2],
+                   int input_file, const char *scratch) {
     int flags = 0;
     int index = 0;
+    int arguments = 0;
     int new_flags = 0;
     char **argv = NULL;
-    struct CString test_path = cstring_init(TESTS_DIRECTORY);
+    struct CString test_path = testcase_path(testcase, scratch);
+    char input_path[64 + 1] = "";
 
-    /* Build the path to the testcase */
-    cstring_concats(&test_path, LIBPATH_SEPARATOR);
-    cstring_concat(&test_path, testcase.path);
+    /* Prepare the argv (+1 for the path to the test at the start, and
+     * +1 for NULL at the end of the array). The testcase's own argv is
+     * left alone, as it can live inside of a mapped cache image. */
+    if(testcase.argv != NULL)
+        arguments = carray_length(testcase.argv);
 
-    /* Prepare the argv (+1 for NULL at the end of the array, and
-     * inserting at 0 for the path to the test */
-    carray_insert(testcase.argv, 0, test_path, CSTRING);
-    argv = malloc((carray_length(testcase.argv) + 1) * sizeof(char *));
+    argv = malloc((arguments + 2) * sizeof(char *));
+    argv[0] = test_path.contents;
 
     /* Extract pointers to all the contents of each argument */
-    for(index = 0; index < carray_length(testcase.argv); index++) {
-        argv[index] = testcase.argv->contents[index].contents;
+    for(index = 0; index < arguments; index++) {
+        argv[index + 1] = testcase.argv->contents[index].contents;
     }
 
     /* NULL so that execv can work on the array */
-    argv[index] = NULL;
+    argv[index + 1] = NULL;
 
     /* Oh boy. This section has to be the single most confusing part in
      * this entire program. This might take a little bit to explain.
@@ -188,15 +275,18 @@ void testcase_fork(struct Testcase testcase, int parent_to_child[2], int child_t
      * connected to a terminal, then as far as I can tell, read will have
      * special reading behavior for terminals, and will just pause forever.
     */
-    if(testcase.input.contents != NULL) {
+    if(input_file != -1) {
+        /* A stdin that is a sealed file is shared with other tests, so it
+         * is opened again rather than duplicated, which gives this test
+         * its own offset into it. */
+        libc99_snprintf(input_path, 64, "/proc/self/fd/%i", input_file);
         close(STDIN_FILENO);
-        dup(parent_to_child[0]);
 
-        /* Close unneeded pipe ends for this fork */
-        /*
-        close(parent_to_child[1]);
-        close(child_to_parent[0]);
-        */
+        if(open(input_path, O_RDONLY) == -1)
+            liberror_failure(testcase_fork, open);
+    } else if(testcase.input.contents != NULL) {
+        close(STDIN_FILENO);
+        dup(parent_to_child[0]);
 
         flags = fcntl(parent_to_child[0], F_GETFL, 0);
         flags |= O_NONBLOCK;
@@ -211,24 +301,134 @@ void testcase_fork(struct Testcase testcase, int parent_to_child[2], int child_t
     close(STDERR_FILENO);
     dup(child_to_parent[1]);
 
+    if(scratch != NULL) {
+        if(chdir(scratch) == -1)
+            liberror_failure(testcase_fork, chdir);
+
+        setenv(SCRATCH_VARIABLE, scratch, 1);
+    }
+
+    /* Every end of the pipes that was not duplicated onto a standard
+     * stream is closed by the exec. The test gets the descriptor limit
+     * that catalyst was given, not the one the root raised it to. */
+    restore_descriptor_limit();
+    apply_limits(testcase, 0);
     execv(test_path.contents, argv);
 }
 
-void timeout_test(struct Testcase testcase, int writefd, int pid, int *exit_code) {
-    int waitpid_status = 0;
-    char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
+/*
+ * The root process keeps the deadline of every test, and signals the
+ * runner when it has passed. The test is killed from the handler, so
+ * the runner cannot miss it while it waits for the test. Each test is
+ * the leader of its own process group, so killing the group takes any
+ * processes that the test started with it.
+*/
+static volatile sig_atomic_t timed_out = 0;
+static volatile sig_atomic_t test_pid = 0;
+
+/*
+ * The runner reads the output of the test while it waits for it, so it
+ * has to wake up when the test exits. The handler writes to a pipe that
+ * the runner polls alongside the output, which cannot be missed between
+ * checking on the test and polling, like the signal itself could be.
+*/
+static int exit_pipe[2] = {-1, -1};
+
+static void handle_exit(int signal_number) {
+    int saved_errno = errno;
 
-    libproc_sleep(testcase.timeout * LIBPROC_SLEEP_MILLI);
-    waitpid_status = waitpid(pid, exit_code, WNOHANG);
+    write(exit_pipe[1], "", 1);
+    errno = saved_errno;
+}
 
-    /* Error for waitpid */
-    if(waitpid_status == -1)
-        liberror_failure(timeout_test, waitpid);
+static void handle_timeout(int signal_number) {
+    timed_out = 1;
 
-    /* Child exited in time */
-    if(waitpid_status > 0)
+    if(test_pid > 0)
+        kill(-test_pid, SIGKILL);
+}
+
+/*
+ * Tests are not in the process group of the terminal, so they would not
+ * see an interrupt that cancels the run. The runner takes the test down
+ * with it instead.
+*/
+static void handle_cancel(int signal_number) {
+    if(test_pid > 0)
+        kill(-test_pid, SIGKILL);
+
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+
+void stray_processes_test(struct Testcase testcase, int writefd, int pid) {
+    char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
+
+    /* Anything left in the process group of the test was started by it,
+     * and has outlived it. */
+    if(kill(-pid, 0) == -1)
         return;
 
+    kill(-pid, SIGKILL);
+
+    libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, stray_processes,
+                    testcase.name.contents, testcase.path.contents);
+
+    if(strlen(buffer) >= PROCESS_RESPONSE_LENGTH) {
+        fprintf(stderr, "failed to write error message for testcase '%s' for test '%s'-- too large (%s:%i)\n",
+                testcase.name.contents, testcase.path.contents, __FILE__, __LINE__);
+        abort();
+    }
+
+    write(writefd, buffer, strlen(buffer));
+}
+
+/*
+ * A testcase can ask for a scratch directory of its own to run in, which
+ * is made under a scratch root that is on a tmpfs when there is one. It
+ * is removed when the runner exits, after the response pipe is closed,
+ * so the root process can start the next test while it is removed.
+*/
+static int response_descriptor = -1;
+static char scratch_directory[LIBPATH_MAX_PATH + 1] = "";
+
+static void remove_scratch_directory(void) {
+    close(response_descriptor);
+
+    if(libpath_rmtree(scratch_directory) == LIBPATH_FAILURE) {
+        fprintf(stderr, "catalyst: could not remove scratch directory '%s' (%s)\n",
+                scratch_directory, strerror(errno));
+    }
+}
+
+void make_scratch_directory(int writefd) {
+    const char *root = getenv(SCRATCH_ROOT_VARIABLE);
+
+    if(root == NULL && libpath_exists(SCRATCH_TMPFS_ROOT) == 1)
+        root = SCRATCH_TMPFS_ROOT;
+
+    if(root == NULL)
+        root = SCRATCH_FALLBACK_ROOT;
+
+    /* Runners are named after their pid, so anything already there was
+     * left by a runner that was cancelled. */
+    libc99_snprintf(scratch_directory, LIBPATH_MAX_PATH, "%s%scatalyst.%i.%i", root,
+                    LIBPATH_SEPARATOR, (int) getppid(), (int) getpid());
+    libpath_rmtree(scratch_directory);
+
+    if(libpath_mkdir(scratch_directory, 0700) == LIBPATH_FAILURE) {
+        fprintf(stderr, "catalyst: could not make scratch directory '%s' (%s)\n",
+                scratch_directory, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    response_descriptor = writefd;
+    atexit(remove_scratch_directory);
+}
+
+void timeout_test(struct Testcase testcase, int writefd) {
+    char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
+
     /* Write the error message and handle any errors when
      * writing it */
     libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, timeout_failure,
@@ -241,56 +441,122 @@ void timeout_test(struct Testcase testcase, int writefd, int pid, int *exit_code
     }
 
     write(writefd, buffer, strlen(buffer));
-    kill(pid, SIGKILL);
     exit(EXIT_FAILURE);
 }
 
-void aborted_failure(struct Testcase testcase, int writefd, int readfd, int pid, int exit_code) {
+static void limit_failure(struct Testcase testcase, int writefd, const char *format,
+                          unsigned long limit) {
     char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
-    struct CString process_output = cstring_init("");
 
-    /* Test did not abort. Though, it could still be a generic
-     * failed exit code, but this is not what this test is for. */
-    if(exit_code != LIBPROC_ABORTED)
-        return;
+    libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, format,
+                    testcase.name.contents, testcase.path.contents, limit);
 
-    /* Extract the process's output (if there is any to read). We can be
-     * sure that there will not be any text to read if there is none NOW
-     * because.. the process exited. */
-    if(fd_is_readable(readfd) == 1) {
-        int read_bytes = 0;
-        char read_buffer[512 + 1];
+    if(strlen(buffer) >= PROCESS_RESPONSE_LENGTH) {
+        fprintf(stderr, "failed to write error message for testcase '%s' for test '%s'-- too large (%s:%i)\n",
+                testcase.name.contents, testcase.path.contents, __FILE__, __LINE__);
+        abort();
+    }
 
-        INIT_VARIABLE(read_buffer);
+    write(writefd, buffer, strlen(buffer));
+    exit(EXIT_FAILURE);
+}
 
-        while(1) {
-            read_bytes = read(readfd, read_buffer, 512);
+/*
+ * Find out whether a test broke one of its limits, from how it died. A
+ * test that runs out of memory under its limit fails to allocate, and
+ * does not get a signal of its own for it, so crashing while it has a
+ * memory limit is taken to be running out of memory, but only when it
+ * had most of that memory resident. Any other crash is left to report
+ * itself.
+*/
+void limits_test(struct Testcase testcase, int writefd, int exit_code, int output_exceeded,
+                 struct rusage usage) {
+    int signal_number = WIFSIGNALED(exit_code) ? WTERMSIG(exit_code) : 0;
+    unsigned long rss = (unsigned long) usage.ru_maxrss;
 
-            /* Dump the string */
-            if(read_bytes == 512) {
-                cstring_concats(&process_output, read_buffer);
+    /* Resident sizes are in bytes on macOS, and kilobytes elsewhere */
+#if !defined(__APPLE__)
+    rss *= 1024;
+#endif
 
-                continue;
-            } 
+    if(output_exceeded == 1 || signal_number == SIGXFSZ)
+        limit_failure(testcase, writefd, output_failure, testcase.max_output_bytes);
 
-            /* Interrupts are nothing to worry about-- just write
-             * what we currently have and keep going */
-            if(errno == EINTR) {
-                cstring_concats(&process_output, read_buffer);
+    if(testcase.max_cpu_seconds != 0 &&
+       (signal_number == SIGXCPU || (signal_number == SIGKILL &&
+        (unsigned long) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) >= testcase.max_cpu_seconds))) {
+        limit_failure(testcase, writefd, cpu_failure, testcase.max_cpu_seconds);
+    }
 
-                continue;
-            }
+    if(testcase.max_memory == 0 || rss < testcase.max_memory / 4 * 3)
+        return;
 
-            /* Unknown error */
-            if(errno == -1)
-                liberror_failure(aborted_failure, read);
+    switch(signal_number) {
+        case SIGSEGV:
+        case SIGBUS:
+        case SIGABRT:
+        case SIGKILL:
+            limit_failure(testcase, writefd, memory_failure, testcase.max_memory);
+    }
+}
 
-            cstring_concats(&process_output, read_buffer);
+static void budget_failure(struct Testcase testcase, int writefd, const char *format,
+                           unsigned long measured, unsigned long budget) {
+    char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
 
-            break;
-        }
+    libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, format,
+                    testcase.name.contents, testcase.path.contents, measured, budget);
+
+    if(strlen(buffer) >= PROCESS_RESPONSE_LENGTH) {
+        fprintf(stderr, "failed to write error message for testcase '%s' for test '%s'-- too large (%s:%i)\n",
+                testcase.name.contents, testcase.path.contents, __FILE__, __LINE__);
+        abort();
     }
 
+    write(writefd, buffer, strlen(buffer));
+    exit(EXIT_FAILURE);
+}
+
+static unsigned long elapsed_milliseconds(struct timespec started, struct timespec finished) {
+    return (unsigned long) ((finished.tv_sec - started.tv_sec) * 1000 +
+                            (finished.tv_nsec - started.tv_nsec) / 1000000);
+}
+
+/*
+ * A test that finished can still have been too slow, or too big. The
+ * usage is of the test and every process of it that was waited for, and
+ * the wall time is from the fork of the test to reaping it.
+*/
+void budgets_test(struct Testcase testcase, int writefd, struct rusage usage,
+                  unsigned long wall) {
+    unsigned long cpu = (unsigned long) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+                        (unsigned long) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+    unsigned long rss = (unsigned long) usage.ru_maxrss;
+
+    /* Resident sizes are in bytes on macOS, and kilobytes elsewhere */
+#if defined(__APPLE__)
+    rss /= 1024;
+#endif
+
+    if(testcase.max_wall_ms != 0 && wall > testcase.max_wall_ms)
+        budget_failure(testcase, writefd, wall_budget_failure, wall, testcase.max_wall_ms);
+
+    if(testcase.max_cpu_ms != 0 && cpu > testcase.max_cpu_ms)
+        budget_failure(testcase, writefd, cpu_budget_failure, cpu, testcase.max_cpu_ms);
+
+    if(testcase.max_rss_kb != 0 && rss > testcase.max_rss_kb)
+        budget_failure(testcase, writefd, rss_budget_failure, rss, testcase.max_rss_kb);
+}
+
+void aborted_failure(struct Testcase testcase, int writefd, struct CString output, int exit_code) {
+    char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
+
+    /* Test did not abort. Though, it could still be a generic
+     * failed exit code, but this is not what this test is for. It
+     * aborted whether or not it dumped core. */
+    if(WIFSIGNALED(exit_code) == 0 || WTERMSIG(exit_code) != SIGABRT)
+        return;
+
     /* Due to a limitation of either UNIX, or the libc (currently unsure)
      * aborting the program will not flush the standard streams. This is 
      * mostly an OK situation, as things like assert will flush the buffer
@@ -299,13 +565,13 @@ void aborted_failure(struct Testcase testcase, int writefd, int readfd, int pid,
      * the read output. So if a programmer wants to have abort in their program
      * and display error messages with them, they should make sure to flush
      * the stdout and stderr. */
-    if(process_output.length == 0) {
+    if(output.length == 0) {
         libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, abortion_failure_no_output,
                         testcase.name.contents, testcase.path.contents);
 
     } else {
         libc99_snprintf(buffer, PROCESS_RESPONSE_LENGTH, abortion_failure,
-                        testcase.name.contents, testcase.path.contents, process_output.contents);
+                        testcase.name.contents, testcase.path.contents, output.contents);
     }
 
     if(strlen(buffer) >= PROCESS_RESPONSE_LENGTH) {
@@ -314,11 +580,78 @@ void aborted_failure(struct Testcase testcase, int writefd, int readfd, int pid,
         abort();
     }
 
-    cstring_free(process_output);
     write(writefd, buffer, strlen(buffer));
     exit(EXIT_FAILURE);
 }
 
+/*
+ * Read everything the test has written so far, and return how much it
+ * was. Only the start of the output is kept, which is as much as an
+ * error message can show. Once every writer has closed the pipe, there
+ * is nothing left to read.
+*/
+static unsigned long drain_output(int readfd, struct CString *output, int *closed) {
+    int read_bytes = 0;
+    unsigned long total = 0;
+    char read_buffer[512 + 1] = "";
+
+    if(*closed == 1)
+        return 0;
+
+    while((read_bytes = read(readfd, read_buffer, 512)) != 0) {
+        if(read_bytes == -1 && errno == EINTR)
+            continue;
+
+        if(read_bytes == -1 && errno == EAGAIN)
+            break;
+
+        if(read_bytes == -1)
+            liberror_failure(drain_output, read);
+
+        total += read_bytes;
+
+        if(output->length + read_bytes > PROCESS_RESPONSE_LENGTH)
+            continue;
+
+        read_buffer[read_bytes] = '\0';
+        cstring_concats(output, read_buffer);
+    }
+
+    *closed = read_bytes == 0;
+
+    return total;
+}
+
+/*
+ * Write as much of the stdin of the test as the pipe takes without
+ * blocking, and return whether there is nothing left to write. A test
+ * that exits or closes its stdin before reading all of it has stopped
+ * reading, which is up to the test.
+*/
+static int feed_input(int writefd, struct CString input, int *fed) {
+    int written_bytes = 0;
+
+    while(*fed < input.length) {
+        written_bytes = (int) write(writefd, input.contents + *fed, input.length - *fed);
+
+        if(written_bytes == -1 && errno == EINTR)
+            continue;
+
+        if(written_bytes == -1 && errno == EAGAIN)
+            return 0;
+
+        if(written_bytes == -1 && errno == EPIPE)
+            return 1;
+
+        if(written_bytes == -1)
+            liberror_failure(feed_input, write);
+
+        *fed += written_bytes;
+    }
+
+    return 1;
+}
+
 void successful_test(struct Testcase testcase, int writefd, int pid) {
     char buffer[PROCESS_RESPONSE_LENGTH + 1] = "";
 
@@ -336,54 +669,367 @@ void successful_test(struct Testcase testcase, int writefd, int pid) {
     write(writefd, buffer, strlen(buffer));
 }
 
-void handle_testcase(struct Testcase testcase, struct PipePair pair) {
+/*
+ * Ask the forkserver of a test to fork it, rather than executing it, and
+ * return the socket that the forkserver answers through, or -1 when the
+ * test has to be executed after all. The test is given the same stdin
+ * and output as it would be if it were executed.
+*/
+static int forkserver_test(struct Testcase testcase, int forkserver, int parent_to_child[2],
+                           int child_to_parent[2], int input_file, const char *scratch,
+                           int *pid) {
+    int index = 0;
+    int length = 0;
+    int reply = -1;
+    int arguments = 0;
+    int input = STDIN_FILENO;
+    char *request = NULL;
+    char input_path[64 + 1] = "";
+    struct CString test_path;
+
+    if(forkserver == -1)
+        return -1;
+
+    if(testcase.argv != NULL)
+        arguments = carray_length(testcase.argv);
+
+    /* The request is the scratch directory, which is empty for a test
+     * without one, and then the argv, each ended by a NUL. */
+    test_path = testcase_path(testcase, scratch);
+    length = (scratch == NULL ? 0 : (int) strlen(scratch)) + 1 + test_path.length + 1;
+
+    for(index = 0; index < arguments; index++) {
+        length += testcase.argv->contents[index].length + 1;
+    }
+
+    request = malloc(length);
+    length = 0;
+
+    if(scratch != NULL) {
+        memcpy(request, scratch, strlen(scratch));
+        length += (int) strlen(scratch);
+    }
+
+    request[length++] = '\0';
+    memcpy(request + length, test_path.contents, test_path.length + 1);
+    length += test_path.length + 1;
+
+    for(index = 0; index < arguments; index++) {
+        struct CString argument = testcase.argv->contents[index];
+
+        memcpy(request + length, argument.contents, argument.length);
+        length += argument.length;
+        request[length++] = '\0';
+    }
+
+    /* A sealed stdin is opened again for the test, like an executed test
+     * does, so that the test has its own offset into it. */
+    if(input_file != -1) {
+        libc99_snprintf(input_path, 64, "/proc/self/fd/%i", input_file);
+
+        if((input = open(input_path, O_RDONLY)) == -1)
+            liberror_failure(forkserver_test, open);
+    } else if(testcase.input.contents != NULL) {
+        input = parent_to_child[0];
+        fcntl(input, F_SETFL, fcntl(input, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    reply = forkserver_fork(forkserver, request, length, input, child_to_parent[1],
+                            testcase.timeout, pid);
+
+    if(input_file != -1)
+        close(input);
+
+    free(request);
+    cstring_free(test_path);
+
+    return reply;
+}
+
+/*
+ * Find out whether the test has exited, without blocking, and take its
+ * status and usage if it has. A test that was forked by a forkserver is
+ * waited for by the forkserver, which answers once it exits.
+*/
+static int test_exited(int pid, int reply, int *exit_code, struct rusage *usage) {
+    int waited = 0;
+
+    if(reply != -1)
+        return forkserver_wait(reply, exit_code, usage);
+
+    if((waited = waitpid(pid, exit_code, WNOHANG)) == -1)
+        liberror_failure(handle_testcase, waitpid);
+
+    if(waited != 0)
+        getrusage(RUSAGE_CHILDREN, usage);
+
+    return waited != 0;
+}
+
+void handle_testcase(struct Testcase testcase, struct PipePair pair,
+                     struct Placement *placement, int row, int input_file, int forkserver) {
     int pid = 0;
+    int reply = -1;
+    int piped = testcase.input.contents != NULL && input_file == -1;
     int new_flags = 0;
     int exit_code = 0;
+    int fed = 0;
+    int output_closed = 0;
+    int output_exceeded = 0;
+    unsigned long written = 0;
     int parent_to_child[2] = {0, 0};
     int child_to_parent[2] = {0, 0};
+    char exits[16] = "";
+    struct pollfd descriptors[3];
+    struct CString output = cstring_init("");
+    struct timespec started;
+    struct timespec finished;
+    struct rusage usage;
+    sigset_t signals;
+    struct sigaction action;
 
-    /* Disable signal handling in the test runner and the test! (in the test
-     * until the process image is replaced, at least.) */
-    signal(SIGCHLD, SIG_DFL);
+    /* The runner is woken up when the test exits, through a pipe that
+     * the test does not inherit. */
+    if(cloexec_pipe(exit_pipe) == -1)
+        liberror_failure(handle_testcase, pipe);
+
+    fcntl(exit_pipe[0], F_SETFL, fcntl(exit_pipe[0], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(exit_pipe[1], F_SETFL, fcntl(exit_pipe[1], F_GETFL, 0) | O_NONBLOCK);
+
+    INIT_VARIABLE(action);
+    action.sa_handler = handle_exit;
+    action.sa_flags = SA_NOCLDSTOP;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    /* The timeout signal has been blocked since the runner was forked, so
+     * it can only arrive once there is a handler for it. It has to cut
+     * waiting for the test short, so nothing is restarted. */
+    INIT_VARIABLE(action);
+    action.sa_handler = handle_timeout;
+    sigemptyset(&action.sa_mask);
+    sigaction(TESTCASE_TIMEOUT_SIGNAL, &action, NULL);
+
+    /* Signals that cancel the run take the test with the runner */
+    action.sa_handler = handle_cancel;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGHUP, &action, NULL);
+
+    sigemptyset(&signals);
+    sigaddset(&signals, TESTCASE_TIMEOUT_SIGNAL);
+    sigprocmask(SIG_UNBLOCK, &signals, NULL);
 
     /* Only prepare parent_to_child if, and only if there is input to
-     * that the test should expect, please. */
-    if(testcase.input.contents != NULL)
-        pipe(parent_to_child);
+     * that the test should expect, please, and it is not in a file. */
+    if(piped == 1 && cloexec_pipe(parent_to_child) == -1)
+        liberror_failure(handle_testcase, pipe);
 
     /* We always want a communication port between the test and 
      * the test runner, though. */
-    pipe(child_to_parent);
+    if(cloexec_pipe(child_to_parent) == -1)
+        liberror_failure(handle_testcase, pipe);
+
+    fcntl(child_to_parent[0], F_SETFL, fcntl(child_to_parent[0], F_GETFL, 0) | O_NONBLOCK);
+
+    if(testcase.scratch == 1)
+        make_scratch_directory(pair.write);
 
     /* Prepare the child process (will become the test). Should be noted that
      * all allocations under this block will not need to be released due
      * to the process image replacement. */
-    if((pid = fork()) == 0)
-        testcase_fork(testcase, parent_to_child, child_to_parent);
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    reply = forkserver_test(testcase, forkserver, parent_to_child, child_to_parent, input_file,
+                            testcase.scratch == 1 ? scratch_directory : NULL, &pid);
+
+    /* A forkserver that did not fork the test in time has used up the
+     * whole timeout of the testcase */
+    if(reply == -1 && pid == -1)
+        timeout_test(testcase, pair.write);
+
+    if(reply != -1) {
+        /* A forked test waits for the runner to place and limit it, as
+         * it is not the runner's child and cannot do it itself. Its
+         * forkserver made its group before answering. */
+        placement_apply(*placement, row, testcase, pid);
+        apply_limits(testcase, pid);
+        forkserver_release(reply);
+    } else if((pid = fork()) == 0) {
+        setpgid(0, 0);
+        placement_apply(*placement, row, testcase, 0);
+        testcase_fork(testcase, parent_to_child, child_to_parent, input_file,
+                      testcase.scratch == 1 ? scratch_directory : NULL);
+
+        /* The test could not be executed, and must not clean up after
+         * the runner on its way out. */
+        _exit(EXIT_FAILURE);
+    }
+
+    /* The group is made by both processes, so that it exists before
+     * either of them goes on. A timeout from before the test existed
+     * still has to kill it. */
+    if(reply == -1)
+        setpgid(pid, pid);
+
+    test_pid = pid;
+
+    if(timed_out == 1)
+        kill(-pid, SIGKILL);
 
     /* Close unnecessary ends of the pipe for the parent process, as the
-     * child process has already inherited its own. */
-    /*
-    close(parent_to_child[0]);
+     * child process has already inherited its own. The output of the
+     * test ends when the test, and whatever it started, closes it. */
     close(child_to_parent[1]);
-    */
 
-    /* Write the stdin to the pipe if there is any to write */
-    if(testcase.input.contents != NULL)
-        write(parent_to_child[1], testcase.input.contents, testcase.input.length);
-    
-    /* Wait for a timeout (in milliseconds). If the test ends in time,
-     * it will fall through. Since the child process can also abort during
-     * the timeout, which will count as a 'successful' test, we want the
-     * exit code to be distributed to the exit code handlers too. */
-    if(testcase.timeout != 0)
-        timeout_test(testcase, pair.write, pid, &exit_code);
+    /* The stdin is written from the wait below, as the test reads it, so
+     * a test that never reads all of it cannot hold the runner up. A test
+     * that stops reading closes the pipe on the runner, which must not
+     * take the runner down with it. The test was forked before this, so
+     * it does not inherit the ignored signal. */
+    if(piped == 1) {
+        signal(SIGPIPE, SIG_IGN);
+        close(parent_to_child[0]);
+        fcntl(parent_to_child[1], F_SETFL, fcntl(parent_to_child[1], F_GETFL, 0) | O_NONBLOCK);
+
+        if(feed_input(parent_to_child[1], testcase.input, &fed) == 1) {
+            close(parent_to_child[1]);
+            piped = 0;
+        }
+    }
+
+    /* Wait for the child process to quit, and extract the exit code. Since
+     * the child process can also abort before its timeout, which will count
+     * as a 'successful' test, the exit code is distributed to the exit
+     * code handlers too. The output of the test is read while it runs, so
+     * that it cannot stall on a full pipe, and is held to its limit. */
+    INIT_VARIABLE(descriptors);
+    INIT_VARIABLE(usage);
+    descriptors[0].fd = child_to_parent[0];
+    descriptors[0].events = POLLIN;
+    descriptors[1].fd = reply == -1 ? exit_pipe[0] : reply;
+    descriptors[1].events = POLLIN;
+    descriptors[2].fd = piped == 1 ? parent_to_child[1] : -1;
+    descriptors[2].events = POLLOUT;
+
+    while(test_exited(pid, reply, &exit_code, &usage) == 0) {
+        if(poll(descriptors, 3, -1) == -1 && errno != EINTR)
+            liberror_failure(handle_testcase, poll);
+
+        while(read(exit_pipe[0], exits, sizeof(exits)) > 0);
+
+        if(descriptors[2].fd != -1 && feed_input(parent_to_child[1], testcase.input, &fed) == 1) {
+            close(parent_to_child[1]);
+            descriptors[2].fd = -1;
+        }
+
+        written += drain_output(child_to_parent[0], &output, &output_closed);
+
+        if(output_closed == 1)
+            descriptors[0].fd = -1;
+
+        if(testcase.max_output_bytes != 0 && written > testcase.max_output_bytes &&
+           output_exceeded == 0) {
+            output_exceeded = 1;
+            kill(-pid, SIGKILL);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    if(reply != -1)
+        close(reply);
 
-    /* Wait for the child process to quit, and extract the exit code */
-    wait(&exit_code);
+    test_pid = 0;
+    written += drain_output(child_to_parent[0], &output, &output_closed);
+    close(child_to_parent[0]);
+
+    /* The test exited before it read all of its stdin */
+    if(descriptors[2].fd != -1)
+        close(parent_to_child[1]);
+
+    if(testcase.max_output_bytes != 0 && written > testcase.max_output_bytes)
+        output_exceeded = 1;
+
+    /* Only a test that was killed for its timeout has timed out. One
+     * that finished just before it did not. */
+    if(timed_out == 1 && WIFSIGNALED(exit_code) && WTERMSIG(exit_code) == SIGKILL)
+        timeout_test(testcase, pair.write);
+
+    limits_test(testcase, pair.write, exit_code, output_exceeded, usage);
+    stray_processes_test(testcase, pair.write, pid);
 
     /* Handle an aborted test if it did abort */
-    aborted_failure(testcase, pair.write, child_to_parent[0], pid, exit_code);
+    aborted_failure(testcase, pair.write, output, exit_code);
+    budgets_test(testcase, pair.write, usage, elapsed_milliseconds(started, finished));
     successful_test(testcase, pair.write, pid);
+    cstring_free(output);
+}
+
+/*
+ * The index of a variant is a number whose digits are the indices into
+ * each axis, with the argv axis as the lowest digit.
+*/
+#define AXIS_LENGTH(axis) \
+    ((axis) == NULL ? 1 : carray_length((axis)))
+
+int testcase_variants(struct Testcase testcase) {
+    return AXIS_LENGTH(testcase.argvs) * AXIS_LENGTH(testcase.inputs) *
+           AXIS_LENGTH(testcase.outputs);
+}
+
+struct Testcase testcase_variant(struct Testcase testcase, int variant) {
+    if(testcase.argvs != NULL)
+        testcase.argv = testcase.argvs->contents[variant % carray_length(testcase.argvs)];
+
+    variant /= AXIS_LENGTH(testcase.argvs);
+
+    if(testcase.inputs != NULL)
+        testcase.input = testcase.inputs->contents[variant % carray_length(testcase.inputs)];
+
+    variant /= AXIS_LENGTH(testcase.inputs);
+
+    if(testcase.outputs != NULL)
+        testcase.output = testcase.outputs->contents[variant % carray_length(testcase.outputs)];
+
+    return testcase;
+}
+
+static void name_axis(struct CString *name, const char *axis, int index, int *first) {
+    char number[32 + 1] = "";
+
+    libc99_itoa(index, number, 32, 10);
+    cstring_concats(name, *first == 1 ? "[" : ", ");
+    cstring_concats(name, axis);
+    cstring_concats(name, " ");
+    cstring_concats(name, number);
+
+    *first = 0;
+}
+
+struct CString testcase_variant_name(struct Testcase testcase, int variant) {
+    int first = 1;
+    struct CString name = cstring_init("");
+
+    if(testcase.name.contents != NULL)
+        cstring_concat(&name, testcase.name);
+    else
+        cstring_concat(&name, testcase.path);
+
+    if(testcase.argvs != NULL)
+        name_axis(&name, "argv", variant % carray_length(testcase.argvs), &first);
+
+    variant /= AXIS_LENGTH(testcase.argvs);
+
+    if(testcase.inputs != NULL)
+        name_axis(&name, "stdin", variant % carray_length(testcase.inputs), &first);
+
+    variant /= AXIS_LENGTH(testcase.inputs);
+
+    if(testcase.outputs != NULL)
+        name_axis(&name, "stdout", variant % carray_length(testcase.outputs), &first);
+
+    if(first == 0)
+        cstring_concats(&name, "]");
+
+    return name;
 }
@@ -40,6 +40,15 @@
 
 struct Testcase;
 struct PipePair;
+struct Placement;
+
+/* Scratch directories are made under the directory in the first of
+ * these variables, or on a tmpfs if there is one. The second tells the
+ * test where its directory is. */
+#define SCRATCH_ROOT_VARIABLE   "CATALYST_SCRATCH_ROOT"
+#define SCRATCH_VARIABLE        "CATALYST_SCRATCH"
+#define SCRATCH_TMPFS_ROOT      "/dev/shm"
+#define SCRATCH_FALLBACK_ROOT   "/tmp"
 
 /*
  * @docgen: function
@@ -50,7 +59,8 @@ struct PipePair;
  *
  * @description
  * @This function will run a testcase in a subprocess, and report a status
- * @message to the root process when the test is complete.
+ * @message to the root process when the test is complete. A test with a
+ * @forkserver is forked by it, rather than executed.
  * @description
  *
  * @param testcase: the testcase information
@@ -58,7 +68,90 @@ struct PipePair;
  *
  * @param pair: a pair of pipes to communicate with the root process
  * @type: struct PipePair
+ *
+ * @param placement: the cpus claimed for the testcase
+ * @type: struct Placement *
+ *
+ * @param row: the row of the testcase table the testcase is
+ * @type: int
+ *
+ * @param input_file: a sealed file holding the stdin of the test, or -1
+ * @type: int
+ *
+ * @param forkserver: the control socket of the test's forkserver, or -1
+ * @type: int
+*/
+void handle_testcase(struct Testcase testcase, struct PipePair pair,
+                     struct Placement *placement, int row, int input_file, int forkserver);
+
+/*
+ * @docgen: function
+ * @brief: count the combinations of a matrix testcase
+ * @name: testcase_variants
+ *
+ * @include: testing.h
+ *
+ * @description
+ * @This function will return the number of concrete testcases that a
+ * @testcase expands into, which is the product of the lengths of its
+ * @axes. A testcase without axes has one variant.
+ * @description
+ *
+ * @param testcase: the testcase to count the variants of
+ * @type: struct Testcase
+ *
+ * @return: the number of variants
+ * @type: int
+*/
+int testcase_variants(struct Testcase testcase);
+
+/*
+ * @docgen: function
+ * @brief: select one combination of a matrix testcase
+ * @name: testcase_variant
+ *
+ * @include: testing.h
+ *
+ * @description
+ * @This function will return the variant'th combination of the axes of
+ * @a testcase as a concrete testcase. The argv, stdin and stdout of the
+ * @variant point into the axes, so nothing is copied or allocated.
+ * @description
+ *
+ * @param testcase: the testcase to select from
+ * @type: struct Testcase
+ *
+ * @param variant: the index of the combination, below testcase_variants
+ * @type: int
+ *
+ * @return: the selected combination
+ * @type: struct Testcase
+*/
+struct Testcase testcase_variant(struct Testcase testcase, int variant);
+
+/*
+ * @docgen: function
+ * @brief: name one combination of a matrix testcase
+ * @name: testcase_variant_name
+ *
+ * @include: testing.h
+ *
+ * @description
+ * @This function will produce the name that the variant'th combination
+ * @of a testcase is reported under, which is the name of the testcase
+ * @followed by the index into each of its axes, like 'name[argv 1, stdin 0]'.
+ * @The name must be released from memory.
+ * @description
+ *
+ * @param testcase: the testcase to name a combination of
+ * @type: struct Testcase
+ *
+ * @param variant: the index of the combination, below testcase_variants
+ * @type: int
+ *
+ * @return: the name of the combination
+ * @type: struct CString
 */
-void handle_testcase(struct Testcase testcase, struct PipePair pair);
+struct CString testcase_variant_name(struct Testcase testcase, int variant);
 
 #endif
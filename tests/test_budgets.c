@@ -0,0 +1,44 @@
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/select.h>
+
+#include "common.h"
+
+/*
+ * Spend some wall time, cpu time or resident memory, given as
+ * '<budget> <amount>' in milliseconds or kilobytes, so that a testcase
+ * can come in under or over its budget.
+*/
+int main(int argc, char **argv) {
+    long amount = 0;
+
+    assert(argc == 3);
+    amount = atol(argv[2]);
+
+    if(strcmp(argv[1], "wall") == 0) {
+        struct timeval wait;
+
+        wait.tv_sec = amount / 1000;
+        wait.tv_usec = (amount % 1000) * 1000;
+        select(0, NULL, NULL, NULL, &wait);
+    } else if(strcmp(argv[1], "cpu") == 0) {
+        clock_t until = clock() + (clock_t) (amount * (CLOCKS_PER_SEC / 1000));
+
+        while(clock() < until)
+            continue;
+    } else if(strcmp(argv[1], "rss") == 0) {
+        char *memory = malloc((size_t) amount * 1024);
+
+        assert(memory != NULL);
+        memset(memory, 1, (size_t) amount * 1024);
+        free(memory);
+    } else {
+        assert(0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "common.h"
+
+/*
+ * Run catalyst on the configuration in tests/configs/<argv[1]>, with the
+ * environment variable argv[3] set to argv[4] if they are given, and
+ * check that what it writes contains argv[2].
+*/
+int main(int argc, char **argv) {
+    int status = 0;
+    int output_pipe[2];
+    char output[4096] = {0};
+    int length = 0;
+    int bytes = 0;
+    pid_t pid = 0;
+
+    assert(argc == 3 || argc == 5);
+    assert(pipe(output_pipe) == 0);
+
+    if((pid = fork()) == 0) {
+        dup2(output_pipe[1], STDOUT_FILENO);
+        dup2(output_pipe[1], STDERR_FILENO);
+        close(output_pipe[0]);
+        close(output_pipe[1]);
+
+        if(argc == 5)
+            setenv(argv[3], argv[4], 1);
+
+        if(chdir("tests/configs") == -1 || chdir(argv[1]) == -1)
+            _exit(127);
+
+        execl("../../../catalyst", "catalyst", "-j", "1", (char *) NULL);
+        _exit(127);
+    }
+
+    close(output_pipe[1]);
+
+    while((bytes = read(output_pipe[0], output + length, sizeof(output) - 1 - length)) > 0)
+        length += bytes;
+
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) != 127);
+    assert(strstr(output, argv[2]) != NULL);
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include "common.h"
+#include "../src/forkserver/forkserver.h"
+
+/*
+ * Check that the testcase was forked from a forkserver when it asked for
+ * one, and was given its argv, stdin and limits like an executed test.
+*/
+int main(int argc, char **argv) {
+    pid_t server = getpid();
+    struct rlimit limit;
+    char input[64] = {0};
+    int length = 0;
+    int bytes = 0;
+
+    catalyst_forkserver(&argc, &argv);
+    assert(argc == 2);
+
+    if(strcmp(argv[1], "executed") == 0) {
+        assert(getpid() == server);
+
+        return 0;
+    }
+
+    assert(getpid() != server);
+
+    if(strcmp(argv[1], "hang") == 0) {
+        pause();
+    } else if(strcmp(argv[1], "stdin") == 0) {
+        while((bytes = read(STDIN_FILENO, input + length, sizeof(input) - 1 - length)) != 0) {
+            if(bytes == -1 && errno == EAGAIN)
+                continue;
+
+            assert(bytes > 0);
+            length += bytes;
+        }
+
+        assert(strcmp(input, "forked stdin") == 0);
+    } else if(strcmp(argv[1], "limits") == 0) {
+        assert(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+        assert(limit.rlim_cur == 32);
+    } else if(strcmp(argv[1], "memory") == 0) {
+        /* Run out of memory a chunk at a time, with most of the limit
+         * resident by then */
+        for(length = 0; length < 128; length++) {
+            char *chunk = malloc(1048576);
+
+            if(chunk == NULL)
+                abort();
+
+            memset(chunk, 1, 1048576);
+        }
+    } else {
+        assert(strcmp(argv[1], "forked") == 0);
+    }
+
+    return 0;
+}
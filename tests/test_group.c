@@ -0,0 +1,40 @@
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/select.h>
+
+#include "common.h"
+
+/*
+ * Start a child that outlives the test, and either exit and leave it
+ * running, or wait until the timeout. Either way, the child is in the
+ * process group of the test and is killed with it.
+*/
+int main(int argc, char **argv) {
+    pid_t child = 0;
+
+    assert(argc == 2);
+    assert((child = fork()) != -1);
+
+    if(child == 0) {
+        struct timeval wait;
+
+        wait.tv_sec = 10;
+        wait.tv_usec = 0;
+        select(0, NULL, NULL, NULL, &wait);
+
+        return 0;
+    }
+
+    assert(getpgrp() == getpid());
+
+    if(strcmp(argv[1], "hang") == 0)
+        pause();
+
+    assert(strcmp(argv[1], "linger") == 0);
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+
+#include "common.h"
+
+#define CHUNK   1048576
+
+/*
+ * Keep an amount of memory resident, a chunk at a time, so that running
+ * out of it under a limit happens with most of the limit in use.
+*/
+static void use_memory(long amount) {
+    char **chunks = malloc((size_t) (amount / CHUNK + 1) * sizeof(*chunks));
+    long length = 0;
+
+    assert(chunks != NULL);
+
+    for(length = 0; length < amount / CHUNK; length++) {
+        if((chunks[length] = malloc(CHUNK)) == NULL)
+            abort();
+
+        memset(chunks[length], 1, CHUNK);
+    }
+
+    while(length-- > 0)
+        free(chunks[length]);
+
+    free(chunks);
+}
+
+/*
+ * Use an amount of one resource, given as '<resource> <amount>', so that
+ * a testcase can put it under or over its limit. 'abort <amount>' uses
+ * that much memory and then aborts anyway.
+*/
+int main(int argc, char **argv) {
+    long amount = 0;
+
+    assert(argc == 3);
+    amount = atol(argv[2]);
+
+    if(strcmp(argv[1], "memory") == 0) {
+        use_memory(amount);
+    } else if(strcmp(argv[1], "abort") == 0) {
+        use_memory(amount);
+        abort();
+    } else if(strcmp(argv[1], "cpu") == 0) {
+        clock_t until = clock() + (clock_t) (amount * (CLOCKS_PER_SEC / 1000));
+
+        while(clock() < until)
+            continue;
+    } else if(strcmp(argv[1], "files") == 0) {
+        while(amount-- > 0)
+            assert(open("/dev/null", O_RDONLY) != -1);
+    } else if(strcmp(argv[1], "output") == 0) {
+        while(amount-- > 0)
+            putchar('a');
+    } else {
+        assert(0);
+    }
+
+    return 0;
+}
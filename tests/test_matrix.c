@@ -0,0 +1,29 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+
+#include "common.h"
+
+/*
+ * Read stdin, which should be one of the inputs of the matrix, or hang
+ * until the timeout when asked to.
+*/
+int main(int argc, char **argv) {
+    char input[64] = {0};
+    int length = 0;
+    int bytes = 0;
+
+    assert(argc == 2);
+
+    if(strcmp(argv[1], "hang") == 0)
+        pause();
+
+    while((bytes = read(STDIN_FILENO, input + length, sizeof(input) - 1 - length)) > 0)
+        length += bytes;
+
+    assert(strcmp(input, "first") == 0 || strcmp(input, "second") == 0);
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include "common.h"
+
+/*
+ * Check that the test was given the number of cpus in argv[1], and runs
+ * argv[2] nice levels below its runner, at the best-effort I/O priority
+ * in argv[3].
+*/
+int main(int argc, char **argv) {
+    int nice = 0;
+    int expected = 0;
+#if defined(__linux__)
+    cpu_set_t cores;
+#endif
+
+    assert(argc == 4);
+
+#if defined(__linux__)
+    CPU_ZERO(&cores);
+    assert(sched_getaffinity(0, sizeof(cores), &cores) == 0);
+    assert(CPU_COUNT(&cores) == atoi(argv[1]));
+
+    /* The best-effort class is 2, above 13 bits of priority */
+    assert(syscall(SYS_ioprio_get, 1, 0) == ((2 << 13) | atoi(argv[3])));
+#endif
+
+    errno = 0;
+    nice = getpriority(PRIO_PROCESS, 0);
+    assert(errno == 0);
+
+    expected = getpriority(PRIO_PROCESS, getppid()) + atoi(argv[2]);
+    assert(errno == 0);
+    assert(nice == (expected > 19 ? 19 : expected));
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#include "common.h"
+
+/*
+ * Check that the test runs in an empty scratch directory of its own, or
+ * in the directory catalyst was started in when it has none.
+*/
+int main(int argc, char **argv) {
+    const char *scratch = getenv("CATALYST_SCRATCH");
+    char directory[4096] = {0};
+    struct dirent *entry = NULL;
+    DIR *listing = NULL;
+    int file = -1;
+
+    assert(argc == 2);
+
+    if(strcmp(argv[1], "shared") == 0) {
+        assert(scratch == NULL);
+        assert(access(".catalyst", F_OK) == 0);
+
+        return 0;
+    }
+
+    assert(scratch != NULL);
+    assert(getcwd(directory, sizeof(directory)) != NULL);
+    assert(strcmp(directory, scratch) == 0);
+    assert((listing = opendir(".")) != NULL);
+
+    while((entry = readdir(listing)) != NULL)
+        assert(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0);
+
+    closedir(listing);
+
+    /* Leave a file behind for the runner to remove */
+    assert((file = open("scratch.txt", O_WRONLY | O_CREAT | O_EXCL, 0600)) != -1);
+    close(file);
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+static void read_input(const char *expected) {
+    char input[256] = {0};
+    int length = 0;
+    int bytes = 0;
+
+    while((bytes = read(STDIN_FILENO, input + length, sizeof(input) - 1 - length)) != 0) {
+        if(bytes == -1 && errno == EAGAIN)
+            continue;
+
+        assert(bytes > 0);
+        length += bytes;
+    }
+
+    assert(strcmp(input, expected) == 0);
+}
+
+/*
+ * Check that stdin is a sealed file when the testcase asks for one, and
+ * a pipe when it does not. A file has an offset of its own for each
+ * test, so it can be read from the start again.
+*/
+int main(int argc, char **argv) {
+    struct stat status;
+
+    assert(argc == 3);
+    assert(fstat(STDIN_FILENO, &status) == 0);
+
+    if(strcmp(argv[1], "pipe") == 0) {
+        assert(S_ISFIFO(status.st_mode));
+        read_input(argv[2]);
+
+        return 0;
+    }
+
+    assert(S_ISREG(status.st_mode));
+    assert(lseek(STDIN_FILENO, 0, SEEK_CUR) == 0);
+    read_input(argv[2]);
+
+    assert(lseek(STDIN_FILENO, 0, SEEK_SET) == 0);
+    read_input(argv[2]);
+
+    return 0;
+}